@@ -0,0 +1,264 @@
+#include <QtTest>
+#include <QHotkey>
+#include <QHotkeyTrace>
+#include <QBuffer>
+#include "qhotkey_p.h"
+#include <X11/X.h>
+#include <xcb/xcb.h>
+
+class QHotkeyBench : public QObject
+{
+	Q_OBJECT
+
+private Q_SLOTS:
+	void initTestCase();
+
+	void nativeShortcut();
+	void hashCollisions_data();
+	void hashCollisions();
+	void hashLookup();
+	void registration_data();
+	void registration();
+	void dispatch_data();
+	void dispatch();
+	void replay();
+
+private:
+	static QList<QHotkey::NativeShortcut> shortcutSpace();
+	static QHotkey::NativeShortcut benchShortcut(int index);
+	static QList<QHotkey*> createHotkeys(int count, QObject *parent);
+	static xcb_key_press_event_t keyEvent(uint8_t type, QHotkey::NativeShortcut shortcut);
+};
+
+void QHotkeyBench::initTestCase()
+{
+	if(!QHotkey::setBackend(QStringLiteral("x11")) || !QHotkey::isPlatformSupported())
+		QSKIP("The benchmarks require an X11 session, e.g. run them via xvfb-run");
+}
+
+void QHotkeyBench::nativeShortcut()
+{
+	static const Qt::Key keys[] = {
+		Qt::Key_A,
+		Qt::Key_Z,
+		Qt::Key_5,
+		Qt::Key_F5,
+		Qt::Key_Space,
+		Qt::Key_MediaPlay
+	};
+	const int keyCount = sizeof(keys) / sizeof(keys[0]);
+
+	int index = 0;
+	QBENCHMARK {
+		const QHotkey::NativeShortcut shortcut = QHotkeyPrivate::instance()->nativeShortcut(keys[index++ % keyCount],
+																							Qt::ControlModifier | Qt::AltModifier);
+		Q_UNUSED(shortcut)
+	}
+}
+
+void QHotkeyBench::hashCollisions_data()
+{
+	QTest::addColumn<bool>("legacy");
+
+	QTest::newRow("mixed") << false;
+	QTest::newRow("legacy-xor") << true;
+}
+
+void QHotkeyBench::hashCollisions()
+{
+	QFETCH(bool, legacy);
+
+	// counts the shortcuts that land in an occupied bucket of a power of two table, like the one of QHash
+	const QList<QHotkey::NativeShortcut> shortcuts = shortcutSpace();
+	quint64 mask = 1;
+	while(mask < static_cast<quint64>(shortcuts.size()) * 2)
+		mask *= 2;
+	--mask;
+
+	QSet<quint64> buckets;
+	int collisions = 0;
+	for(QHotkey::NativeShortcut shortcut : shortcuts) {
+		const quint64 hash = legacy ?
+								 qHash(shortcut.key) ^ qHash(shortcut.modifier) :
+								 qHash(shortcut);
+		if(buckets.contains(hash & mask))
+			++collisions;
+		else
+			buckets.insert(hash & mask);
+	}
+	QTest::setBenchmarkResult(collisions, QTest::Events);
+}
+
+void QHotkeyBench::hashLookup()
+{
+	const QList<QHotkey::NativeShortcut> shortcuts = shortcutSpace();
+	QHash<QHotkey::NativeShortcut, int> hash;
+	hash.reserve(shortcuts.size());
+	for(int i = 0; i < shortcuts.size(); ++i)
+		hash.insert(shortcuts[i], i);
+
+	int found = 0;
+	QBENCHMARK {
+		for(QHotkey::NativeShortcut shortcut : shortcuts)
+			found += hash.contains(shortcut);
+	}
+	QVERIFY(found > 0);
+}
+
+void QHotkeyBench::registration_data()
+{
+	QTest::addColumn<int>("count");
+	QTest::addColumn<bool>("batched");
+
+	QTest::newRow("10") << 10 << false;
+	QTest::newRow("100") << 100 << false;
+	QTest::newRow("300") << 300 << false;
+	QTest::newRow("10-batched") << 10 << true;
+	QTest::newRow("100-batched") << 100 << true;
+	QTest::newRow("300-batched") << 300 << true;
+	QTest::newRow("1000-batched") << 1000 << true;
+}
+
+void QHotkeyBench::registration()
+{
+	QFETCH(int, count);
+	QFETCH(bool, batched);
+
+	QObject parent;
+	const QList<QHotkey*> hotkeys = createHotkeys(count, &parent);
+	QBENCHMARK {
+		if(batched)
+			QVERIFY(QHotkey::registerAll(hotkeys).isEmpty());
+		else {
+			for(QHotkey *hotkey : hotkeys)
+				QVERIFY(hotkey->setRegistered(true));
+		}
+		for(QHotkey *hotkey : hotkeys)
+			QVERIFY(hotkey->setRegistered(false));
+	}
+}
+
+void QHotkeyBench::dispatch_data()
+{
+	QTest::addColumn<bool>("matching");
+
+	QTest::newRow("hit") << true;
+	QTest::newRow("miss") << false;
+}
+
+void QHotkeyBench::dispatch()
+{
+	QFETCH(bool, matching);
+
+	// direct delivery keeps the eventloop out of the measurement
+	QObject parent;
+	const QList<QHotkey*> hotkeys = createHotkeys(1000, &parent);
+	for(QHotkey *hotkey : hotkeys)
+		hotkey->setDeliveryMode(QHotkey::DirectDelivery);
+	QVERIFY(QHotkey::registerAll(hotkeys).isEmpty());
+
+	// keycode 9 is never used by benchShortcut()
+	const QHotkey::NativeShortcut shortcut = matching ?
+												 benchShortcut(500) :
+												 QHotkey::NativeShortcut(9, ControlMask | Mod1Mask);
+	xcb_key_press_event_t press = keyEvent(XCB_KEY_PRESS, shortcut);
+	xcb_key_release_event_t release = keyEvent(XCB_KEY_RELEASE, shortcut);
+
+	QAbstractNativeEventFilter *filter = QHotkeyPrivate::instance();
+	const QByteArray eventType = QByteArrayLiteral("xcb_generic_event_t");
+	_NATIVE_EVENT_RESULT result = 0;
+	QBENCHMARK {
+		filter->nativeEventFilter(eventType, &press, &result);
+		filter->nativeEventFilter(eventType, &release, &result);
+	}
+
+	for(QHotkey *hotkey : hotkeys)
+		hotkey->setRegistered(false);
+}
+
+void QHotkeyBench::replay()
+{
+	QObject parent;
+	const QList<QHotkey*> hotkeys = createHotkeys(1000, &parent);
+	for(QHotkey *hotkey : hotkeys)
+		hotkey->setDeliveryMode(QHotkey::DirectDelivery);
+	QVERIFY(QHotkey::registerAll(hotkeys).isEmpty());
+
+	// record a press and release of every hotkey, as if they came from the X server
+	QBuffer buffer;
+	QVERIFY(buffer.open(QIODevice::ReadWrite));
+	QHotkeyTrace trace;
+	QVERIFY(trace.startRecording(&buffer));
+	QAbstractNativeEventFilter *filter = QHotkeyPrivate::instance();
+	const QByteArray eventType = QByteArrayLiteral("xcb_generic_event_t");
+	_NATIVE_EVENT_RESULT result = 0;
+	for(int i = 0; i < hotkeys.size(); ++i) {
+		xcb_key_press_event_t press = keyEvent(XCB_KEY_PRESS, benchShortcut(i));
+		xcb_key_release_event_t release = keyEvent(XCB_KEY_RELEASE, benchShortcut(i));
+		filter->nativeEventFilter(eventType, &press, &result);
+		filter->nativeEventFilter(eventType, &release, &result);
+	}
+	trace.stopRecording();
+	QCOMPARE(trace.recordedEvents(), quint64(2 * hotkeys.size()));
+
+	QBENCHMARK {
+		buffer.seek(0);
+		QVERIFY(trace.replay(&buffer, QHotkeyTrace::MaximumSpeed));
+	}
+
+	for(QHotkey *hotkey : hotkeys)
+		hotkey->setRegistered(false);
+}
+
+QList<QHotkey::NativeShortcut> QHotkeyBench::shortcutSpace()
+{
+	// every X11 keycode with every combination of the modifiers the x11 backend grabs
+	static const quint32 modifiers[] = {ShiftMask, ControlMask, Mod1Mask, Mod4Mask};
+	QList<QHotkey::NativeShortcut> shortcuts;
+	for(quint32 key = 8; key < 256; ++key) {
+		for(quint32 combination = 0; combination < 16; ++combination) {
+			quint32 modifier = 0;
+			for(int bit = 0; bit < 4; ++bit) {
+				if(combination & (1u << bit))
+					modifier |= modifiers[bit];
+			}
+			shortcuts.append({key, modifier});
+		}
+	}
+	return shortcuts;
+}
+
+QHotkey::NativeShortcut QHotkeyBench::benchShortcut(int index)
+{
+	// combinations that are unlikely to be taken by a desktop environment, 240 keycodes each
+	static const quint32 modifiers[] = {
+		ControlMask | Mod1Mask,
+		ControlMask | ShiftMask | Mod1Mask,
+		Mod4Mask | ControlMask,
+		Mod4Mask | Mod1Mask,
+		Mod4Mask | ShiftMask | ControlMask
+	};
+	return {static_cast<quint32>(10 + index % 240), modifiers[index / 240]};
+}
+
+QList<QHotkey*> QHotkeyBench::createHotkeys(int count, QObject *parent)
+{
+	QList<QHotkey*> hotkeys;
+	hotkeys.reserve(count);
+	for(int i = 0; i < count; ++i)
+		hotkeys.append(new QHotkey(benchShortcut(i), false, parent));
+	return hotkeys;
+}
+
+xcb_key_press_event_t QHotkeyBench::keyEvent(uint8_t type, QHotkey::NativeShortcut shortcut)
+{
+	xcb_key_press_event_t event = {};
+	event.response_type = type;
+	event.detail = static_cast<xcb_keycode_t>(shortcut.key);
+	event.state = static_cast<uint16_t>(shortcut.modifier);
+	return event;
+}
+
+QTEST_MAIN(QHotkeyBench)
+
+#include "qhotkeybench.moc"
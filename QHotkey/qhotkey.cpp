@@ -1,13 +1,203 @@
 #include "qhotkey.h"
 #include "qhotkey_p.h"
+#include "qhotkeytrace.h"
 #include <QCoreApplication>
+#include <QGuiApplication>
+#include <QWindow>
+#include <QDir>
+#include <QFileInfo>
+#include <QMap>
+#include <QSaveFile>
 #include <QAbstractEventDispatcher>
+#include <QFutureInterface>
+#include <QJsonArray>
 #include <QMetaMethod>
+#include <QSet>
 #include <QThread>
+#include <QVarLengthArray>
 #include <QDebug>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 
 Q_LOGGING_CATEGORY(logQHotkey, "QHotkey")
 
+namespace {
+
+static_assert(sizeof(QHotkey::NativeShortcut) == sizeof(quint64), "NativeShortcut must stay packed into 8 bytes");
+
+// marks an unused bucket of the dispatch table, invalid shortcuts are never registered
+constexpr quint64 EmptyDispatchKey = QHotkey::NativeShortcut().packed();
+
+inline qint64 monotonicNsecs()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// finalizer of MurmurHash3, spreads dense keycode/modifier values over all bits
+inline quint64 mixShortcut(quint64 key)
+{
+	key ^= key >> 33;
+	key *= Q_UINT64_C(0xff51afd7ed558ccd);
+	key ^= key >> 33;
+	key *= Q_UINT64_C(0xc4ceb9fe1a85ec53);
+	key ^= key >> 33;
+	return key;
+}
+
+// global grabs report their key events for the focus window of this application as well, if it has the focus
+inline QHotkeyEvent globalEvent(const QHotkeyEvent &event)
+{
+	return QHotkeyEvent(event.nativeShortcut(),
+						event.nativeKeycode(),
+						event.nativeState(),
+						event.timestamp(),
+						event.receiveNsecs(),
+						event.isRepeat());
+}
+
+// layout of the key cache file, in native byte order: the header, followed by the entries sorted by key and modifiers
+struct KeyCacheHeader {
+	char magic[8];
+	quint32 version;
+	quint32 count;
+	quint64 keymapHash;
+};
+
+struct KeyCacheEntry {
+	quint32 key;
+	quint32 modifiers;
+	quint32 nativeKey;
+	quint32 nativeModifier;
+};
+
+const char KeyCacheMagic[8] = {'Q', 'H', 'K', 'Y', 'K', 'E', 'Y', 'S'};
+const quint32 KeyCacheVersion = 1;
+// collects new translations, so starting up only writes the file once
+const int KeyCacheWriteDelay = 1000;
+
+inline quint64 keyCacheKey(quint32 key, quint32 modifiers)
+{
+	return (static_cast<quint64>(key) << 32) | modifiers;
+}
+
+// the hold wheel covers 2.56 seconds per round, longer thresholds take several rounds
+const qint64 HoldWheelTickNsecs = Q_INT64_C(10000000);
+const int HoldWheelSize = 256;
+
+// the modifier a modifier key sets itself, which is not part of its own shortcut
+Qt::KeyboardModifiers ownModifier(Qt::Key key)
+{
+	switch (key) {
+	case Qt::Key_Shift:
+		return Qt::ShiftModifier;
+	case Qt::Key_Control:
+		return Qt::ControlModifier;
+	case Qt::Key_Alt:
+		return Qt::AltModifier;
+	case Qt::Key_Meta:
+	case Qt::Key_Super_L:
+	case Qt::Key_Super_R:
+		return Qt::MetaModifier;
+	default:
+		return Qt::NoModifier;
+	}
+}
+
+}
+
+#ifdef QHOTKEY_HAVE_VIRTUAL
+DECLARE_NATIVE_BACKEND(Virtual)
+#endif
+#ifdef QHOTKEY_HAVE_MAC
+DECLARE_NATIVE_BACKEND(Mac)
+#endif
+#ifdef QHOTKEY_HAVE_WIN
+DECLARE_NATIVE_BACKEND(Win)
+#endif
+#ifdef QHOTKEY_HAVE_X11
+DECLARE_NATIVE_BACKEND(X11)
+#endif
+#ifdef QHOTKEY_HAVE_EVDEV
+DECLARE_NATIVE_BACKEND(Evdev)
+#endif
+
+namespace {
+
+struct Backend {
+	const char *name;
+	QHotkeyPrivate *(*instance)();
+	bool (*isSupported)();
+	bool automatic;//false if only used when selected by name
+};
+
+// without an explicit choice, the first supported automatic backend is used
+const Backend backends[] = {
+#ifdef QHOTKEY_HAVE_MAC
+	{"mac", &qhotkeyMacInstance, &qhotkeyIsMacSupported, true},
+#endif
+#ifdef QHOTKEY_HAVE_WIN
+	{"windows", &qhotkeyWinInstance, &qhotkeyIsWinSupported, true},
+#endif
+#ifdef QHOTKEY_HAVE_X11
+	{"x11", &qhotkeyX11Instance, &qhotkeyIsX11Supported, true},
+#endif
+#ifdef QHOTKEY_HAVE_EVDEV
+	// cannot grab keys and needs access to the input devices, so it is only used when selected
+	{"evdev", &qhotkeyEvdevInstance, &qhotkeyIsEvdevSupported, false},
+#endif
+#ifdef QHOTKEY_HAVE_VIRTUAL
+	// always supported, so it would hide the real backends
+	{"virtual", &qhotkeyVirtualInstance, &qhotkeyIsVirtualSupported, false},
+#endif
+};
+
+struct BackendSelection {
+	QMutex mutex;
+	QString requested;
+	std::atomic<const Backend*> active{nullptr};
+};
+
+BackendSelection &backendSelection()
+{
+	static BackendSelection selection;
+	return selection;
+}
+
+const Backend *findBackend(const QString &name)
+{
+	for(const Backend &backend : backends) {
+		if(name == QLatin1String(backend.name))
+			return &backend;
+	}
+	return nullptr;
+}
+
+// must be called with the selection mutex locked
+const Backend *resolveBackend(const BackendSelection &selection)
+{
+	if(const Backend *active = selection.active.load())
+		return active;
+
+	QString name = selection.requested;
+	if(name.isEmpty())
+		name = qEnvironmentVariable("QHOTKEY_BACKEND");
+	if(!name.isEmpty()) {
+		if(const Backend *backend = findBackend(name))
+			return backend;
+		qCWarning(logQHotkey) << "Unknown hotkey backend" << name << "- using the default one";
+	}
+
+	for(const Backend &backend : backends) {
+		if(backend.automatic && backend.isSupported())
+			return &backend;
+	}
+	// a build with nothing else but explicit ones uses the first of them
+	return &backends[0];
+}
+
+}
+
 void QHotkey::addGlobalMapping(const QKeySequence &shortcut, QHotkey::NativeShortcut nativeShortcut)
 {
 #if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
@@ -27,11 +217,108 @@ bool QHotkey::isPlatformSupported()
 	return QHotkeyPrivate::isPlatformSupported();
 }
 
+bool QHotkey::setBackend(const QString &name)
+{
+	return QHotkeyPrivate::setBackend(name);
+}
+
+QString QHotkey::backend()
+{
+	return QHotkeyPrivate::backendName();
+}
+
+QStringList QHotkey::availableBackends()
+{
+	return QHotkeyPrivate::availableBackends();
+}
+
+QList<QHotkey*> QHotkey::registerAll(const QList<QHotkey*> &hotkeys)
+{
+	return QHotkeyPrivate::instance()->addShortcuts(hotkeys);
+}
+
+QList<QHotkey*> QHotkey::unregisterAll(const QList<QHotkey*> &hotkeys)
+{
+	return QHotkeyPrivate::instance()->removeShortcuts(hotkeys);
+}
+
+QList<QHotkey::Availability> QHotkey::probe(const QList<QKeySequence> &shortcuts)
+{
+	return QHotkeyPrivate::instance()->probe(shortcuts);
+}
+
+QList<QHotkey*> QHotkey::hotkeysFor(const QKeySequence &shortcut)
+{
+	if(shortcut.isEmpty())
+		return {};
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+	const int key = shortcut[0].toCombined();
+#else
+	const int key = shortcut[0];
+#endif
+	const Qt::Key keyCode = Qt::Key(key & ~Qt::KeyboardModifierMask);
+	const Qt::KeyboardModifiers modifiers = Qt::KeyboardModifiers(key & Qt::KeyboardModifierMask) & ~ownModifier(keyCode);
+	const NativeShortcut nativeShortcut = QHotkeyPrivate::instance()->nativeShortcut(keyCode, modifiers);
+	return nativeShortcut.isValid() ? hotkeysForNative(nativeShortcut) : QList<QHotkey*>();
+}
+
+QList<QHotkey*> QHotkey::hotkeysForNative(NativeShortcut nativeShortcut)
+{
+	return QHotkeyPrivate::instance()->hotkeysFor(nativeShortcut);
+}
+
+bool QHotkey::setBackendThreadMode(bool enabled)
+{
+	return QHotkeyPrivate::instance()->setThreadMode(enabled);
+}
+
+bool QHotkey::backendThreadMode()
+{
+	return QHotkeyPrivate::instance()->threadMode();
+}
+
+void QHotkey::setKeyCacheFile(const QString &path)
+{
+	QHotkeyPrivate::instance()->setKeyCacheFile(path);
+}
+
+void QHotkey::setUngrabDelay(int msecs)
+{
+	QHotkeyPrivate::instance()->setUngrabDelay(msecs);
+}
+
+int QHotkey::ungrabDelay()
+{
+	return QHotkeyPrivate::instance()->ungrabDelay();
+}
+
+void QHotkey::setChordTimeout(int msecs)
+{
+	QHotkeyPrivate::instance()->setChordTimeout(msecs);
+}
+
+int QHotkey::chordTimeout()
+{
+	return QHotkeyPrivate::instance()->chordTimeout();
+}
+
 QHotkey::QHotkey(QObject *parent) :
 	QObject(parent),
 	_keyCode(Qt::Key_unknown),
 	_modifiers(Qt::NoModifier),
-	_registered(false)
+	_registered(false),
+	_deliveryMode(QueuedDelivery),
+	_repeatPolicy(IgnoreRepeats),
+	_repeatInterval(100),
+	_lastActivationNsecs(0),
+	_repeatCount(0),
+	_dispatched(false),
+	_asyncQueued(false),
+	_holdThreshold(0),
+	_holdGeneration(0),
+	_holdFired(false),
+	_scope(GlobalScope),
+	_scopeWindow(0)
 {}
 
 QHotkey::QHotkey(const QKeySequence &shortcut, bool autoRegister, QObject *parent) :
@@ -54,8 +341,14 @@ QHotkey::QHotkey(QHotkey::NativeShortcut shortcut, bool autoRegister, QObject *p
 
 QHotkey::~QHotkey()
 {
+	// queued async calls must not touch the hotkey anymore, this waits for one that runs right now
+	if(_asyncQueued)
+		QHotkeyPrivate::instance()->cancelAsyncCalls(this);
 	if(_registered)
 		QHotkeyPrivate::instance()->removeShortcut(this);
+	// a listener thread may still deliver to the hotkey, with a table from before it was removed
+	if(_dispatched)
+		QHotkeyPrivate::instance()->waitForDispatchers();
 }
 
 QKeySequence QHotkey::shortcut() const
@@ -64,10 +357,11 @@ QKeySequence QHotkey::shortcut() const
 		return QKeySequence();
 
 #if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
-	return QKeySequence((_keyCode | _modifiers).toCombined());
+	const int key = (_keyCode | _modifiers).toCombined();
 #else
-	return QKeySequence(static_cast<int>(_keyCode | _modifiers));
+	const int key = static_cast<int>(_keyCode | _modifiers);
 #endif
+	return QKeySequence(key, _chordKeys.value(0), _chordKeys.value(1), _chordKeys.value(2));
 }
 
 Qt::Key QHotkey::keyCode() const
@@ -85,19 +379,55 @@ QHotkey::NativeShortcut QHotkey::currentNativeShortcut() const
 	return _nativeShortcut;
 }
 
+QHotkey::DeliveryMode QHotkey::deliveryMode() const
+{
+	return _deliveryMode;
+}
+
+QHotkey::RepeatPolicy QHotkey::repeatPolicy() const
+{
+	return _repeatPolicy;
+}
+
+int QHotkey::repeatInterval() const
+{
+	return _repeatInterval;
+}
+
+int QHotkey::holdThreshold() const
+{
+	return _holdThreshold;
+}
+
+QHotkey::Scope QHotkey::scope() const
+{
+	return _scope;
+}
+
+WId QHotkey::scopeWindow() const
+{
+	return _scopeWindow;
+}
+
 bool QHotkey::isRegistered() const
 {
 	return _registered;
 }
 
+QFuture<bool> QHotkey::registerAsync()
+{
+	return QHotkeyPrivate::instance()->addShortcutAsync(this);
+}
+
+QFuture<bool> QHotkey::unregisterAsync()
+{
+	return QHotkeyPrivate::instance()->removeShortcutAsync(this);
+}
+
 bool QHotkey::setShortcut(const QKeySequence &shortcut, bool autoRegister)
 {
 	if(shortcut.isEmpty())
 		return resetShortcut();
-	if(shortcut.count() > 1) {
-		qCWarning(logQHotkey, "Keysequences with multiple shortcuts are not allowed! "
-							  "Only the first shortcut will be used!");
-	}
 
 #if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
 	const int key = shortcut[0].toCombined();
@@ -105,12 +435,28 @@ bool QHotkey::setShortcut(const QKeySequence &shortcut, bool autoRegister)
 	const int key = shortcut[0];
 #endif
 
-	return setShortcut(Qt::Key(key & ~Qt::KeyboardModifierMask),
-			Qt::KeyboardModifiers(key & Qt::KeyboardModifierMask),
-			autoRegister);
+	// all further keys of the sequence form a chord
+	QVector<int> chordKeys;
+	for(int i = 1; i < static_cast<int>(shortcut.count()); ++i) {
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+		chordKeys.append(shortcut[i].toCombined());
+#else
+		chordKeys.append(shortcut[i]);
+#endif
+	}
+
+	return applyShortcut(Qt::Key(key & ~Qt::KeyboardModifierMask),
+						 Qt::KeyboardModifiers(key & Qt::KeyboardModifierMask),
+						 chordKeys,
+						 autoRegister);
 }
 
 bool QHotkey::setShortcut(Qt::Key keyCode, Qt::KeyboardModifiers modifiers, bool autoRegister)
+{
+	return applyShortcut(keyCode, modifiers, {}, autoRegister);
+}
+
+bool QHotkey::applyShortcut(Qt::Key keyCode, Qt::KeyboardModifiers modifiers, const QVector<int> &chordKeys, bool autoRegister)
 {
 	if(_registered) {
 		if(autoRegister) {
@@ -120,6 +466,8 @@ bool QHotkey::setShortcut(Qt::Key keyCode, Qt::KeyboardModifiers modifiers, bool
 			return false;
 	}
 
+	_chordKeys.clear();
+	_chordShortcuts.clear();
 	if(keyCode == Qt::Key_unknown) {
 		_keyCode = Qt::Key_unknown;
 		_modifiers = Qt::NoModifier;
@@ -127,9 +475,26 @@ bool QHotkey::setShortcut(Qt::Key keyCode, Qt::KeyboardModifiers modifiers, bool
 		return true;
 	}
 
+	// key sequence editors record a bare Ctrl as Ctrl+Control, but the key is pressed without its own modifier
+	modifiers &= ~ownModifier(keyCode);
 	_keyCode = keyCode;
 	_modifiers = modifiers;
 	_nativeShortcut = QHotkeyPrivate::instance()->nativeShortcut(keyCode, modifiers);
+	for(int chordKey : chordKeys) {
+		if(!_nativeShortcut.isValid())
+			break;
+		const NativeShortcut chordShortcut = QHotkeyPrivate::instance()->nativeShortcut(Qt::Key(chordKey & ~Qt::KeyboardModifierMask),
+																						Qt::KeyboardModifiers(chordKey & Qt::KeyboardModifierMask));
+		if(!chordShortcut.isValid()) {
+			keyCode = Qt::Key(chordKey & ~Qt::KeyboardModifierMask);
+			modifiers = Qt::KeyboardModifiers(chordKey & Qt::KeyboardModifierMask);
+			_nativeShortcut = NativeShortcut();
+			break;
+		}
+		_chordKeys.append(chordKey);
+		_chordShortcuts.append(chordShortcut);
+	}
+
 	if(_nativeShortcut.isValid()) {
 		if(autoRegister)
 			return QHotkeyPrivate::instance()->addShortcut(this);
@@ -140,6 +505,8 @@ bool QHotkey::setShortcut(Qt::Key keyCode, Qt::KeyboardModifiers modifiers, bool
 	_keyCode = Qt::Key_unknown;
 	_modifiers = Qt::NoModifier;
 	_nativeShortcut = NativeShortcut();
+	_chordKeys.clear();
+	_chordShortcuts.clear();
 	return false;
 }
 
@@ -153,6 +520,8 @@ bool QHotkey::resetShortcut()
 	_keyCode = Qt::Key_unknown;
 	_modifiers = Qt::NoModifier;
 	_nativeShortcut = NativeShortcut();
+	_chordKeys.clear();
+	_chordShortcuts.clear();
 	return true;
 }
 
@@ -166,6 +535,8 @@ bool QHotkey::setNativeShortcut(QHotkey::NativeShortcut nativeShortcut, bool aut
 			return false;
 	}
 
+	_chordKeys.clear();
+	_chordShortcuts.clear();
 	if(nativeShortcut.isValid()) {
 		_keyCode = Qt::Key_unknown;
 		_modifiers = Qt::NoModifier;
@@ -193,124 +564,1405 @@ bool QHotkey::setRegistered(bool registered)
 	return true;
 }
 
+bool QHotkey::setScope(QHotkey::Scope scope, WId window, bool autoRegister)
+{
+	if(scope == WindowScope && window == 0) {
+		qCWarning(logQHotkey) << "A window scope requires a native window";
+		return false;
+	}
+	if(scope != WindowScope)
+		window = 0;
+
+	if(_registered) {
+		if(autoRegister) {
+			if(!QHotkeyPrivate::instance()->removeShortcut(this))
+				return false;
+		} else
+			return false;
+	}
+
+	_scope = scope;
+	_scopeWindow = window;
+	if(autoRegister && _nativeShortcut.isValid())
+		return QHotkeyPrivate::instance()->addShortcut(this);
+	return true;
+}
+
+void QHotkey::setDeliveryMode(QHotkey::DeliveryMode deliveryMode)
+{
+	if(_deliveryMode == deliveryMode)
+		return;
+
+	_deliveryMode = deliveryMode;
+	if(_registered)
+		QHotkeyPrivate::instance()->updateShortcut(this);
+}
+
+void QHotkey::setRepeatPolicy(QHotkey::RepeatPolicy repeatPolicy)
+{
+	if(_repeatPolicy == repeatPolicy)
+		return;
+
+	_repeatPolicy = repeatPolicy;
+	if(_registered)
+		QHotkeyPrivate::instance()->updateShortcut(this);
+}
+
+void QHotkey::setRepeatInterval(int repeatInterval)
+{
+	repeatInterval = qMax(repeatInterval, 0);
+	if(_repeatInterval == repeatInterval)
+		return;
+
+	_repeatInterval = repeatInterval;
+	if(_registered)
+		QHotkeyPrivate::instance()->updateShortcut(this);
+}
+
+void QHotkey::setHoldThreshold(int holdThreshold)
+{
+	holdThreshold = qMax(holdThreshold, 0);
+	if(_holdThreshold == holdThreshold)
+		return;
+
+	_holdThreshold = holdThreshold;
+	if(_registered)
+		QHotkeyPrivate::instance()->updateShortcut(this);
+}
+
 
 
 // ---------- QHotkeyPrivate implementation ----------
 
-QHotkeyPrivate::QHotkeyPrivate()
+QHotkeyPrivate::QHotkeyPrivate() :
+	threadModeEnabled(false),
+	dispatchTable(nullptr),
+	dispatchGeneration(0),
+	readerEpoch(0),
+	retiredTables(nullptr),
+	statsEnabled(false),
+	chordState(nullptr),
+	hasChords(false),
+	chordTimeoutMsecs(1000),
+	keyCachePath(qEnvironmentVariable("QHOTKEY_KEY_CACHE")),
+	keyCacheData(nullptr),
+	keyCacheCount(0),
+	keyCacheLoaded(false),
+	keyCacheHash(0),
+	ungrabDelayMsecs(0),
+	holdWheel(HoldWheelSize),
+	holdWheelPos(0),
+	holdCount(0),
+	holdWheelNsecs(0),
+	activeWindow(0),
+	hasScoped(false),
+	registryWriter(nullptr),
+	registryWriteDepth(0),
+	nextAsyncCall(0),
+	traceRecorder(nullptr),
+	tracing(false)
 {
 	Q_ASSERT_X(qApp, Q_FUNC_INFO, "QHotkey requires QCoreApplication to be instantiated");
+	activeReaders[0].store(0);
+	activeReaders[1].store(0);
+	qRegisterMetaType<QHotkey::NativeShortcut>("QHotkey::NativeShortcut");
+	qRegisterMetaType<QHotkeyEvent>("QHotkeyEvent");
+	qRegisterMetaType<QList<QHotkey*>>("QList<QHotkey*>");
+	qRegisterMetaType<QList<QKeySequence>>("QList<QKeySequence>");
+	qRegisterMetaType<QList<QHotkey::Availability>>("QList<QHotkey::Availability>");
+	chordTimer.setSingleShot(true);
+	connect(&chordTimer, &QTimer::timeout,
+			this, &QHotkeyPrivate::finishChord);
+	keyCacheTimer.setSingleShot(true);
+	keyCacheTimer.setInterval(KeyCacheWriteDelay);
+	connect(&keyCacheTimer, &QTimer::timeout,
+			this, &QHotkeyPrivate::writeKeyCache);
+	ungrabTimer.setSingleShot(true);
+	connect(&ungrabTimer, &QTimer::timeout,
+			this, &QHotkeyPrivate::flushExpiredUngrabs);
+	holdTimer.setTimerType(Qt::PreciseTimer);
+	holdTimer.setInterval(static_cast<int>(HoldWheelTickNsecs / 1000000));
+	connect(&holdTimer, &QTimer::timeout,
+			this, &QHotkeyPrivate::advanceHoldWheel);
+	// active window hotkeys follow the focus window, which only a gui application has
+	auto guiApp = qobject_cast<QGuiApplication*>(QCoreApplication::instance());
+	if(guiApp) {
+		QWindow *focusWindow = QGuiApplication::focusWindow();
+		activeWindow = focusWindow ? focusWindow->winId() : 0;
+		connect(guiApp, &QGuiApplication::focusWindowChanged,
+				this, &QHotkeyPrivate::focusWindowChanged);
+	}
 	qApp->eventDispatcher()->installNativeEventFilter(this);
 }
 
 QHotkeyPrivate::~QHotkeyPrivate()
 {
-	if(!shortcuts.isEmpty())
+	if(!shortcuts.isEmpty() || !chordHotkeys.isEmpty())
 		qCWarning(logQHotkey) << "QHotkeyPrivate destroyed with registered shortcuts!";
 	if(qApp && qApp->eventDispatcher())
 		qApp->eventDispatcher()->removeNativeEventFilter(this);
+	if(keyCacheTimer.isActive())
+		writeKeyCache();
+	delete dispatchTable.load();
+	for(const DispatchTable *table = retiredTables.load(); table;) {
+		const DispatchTable *next = table->nextRetired;
+		delete table;
+		table = next;
+	}
 }
 
-QHotkey::NativeShortcut QHotkeyPrivate::nativeShortcut(Qt::Key keycode, Qt::KeyboardModifiers modifiers)
+QHotkeyPrivate *QHotkeyPrivate::instance()
+{
+	BackendSelection &selection = backendSelection();
+	const Backend *backend = selection.active.load(std::memory_order_acquire);
+	if(Q_UNLIKELY(!backend)) {
+		QMutexLocker locker(&selection.mutex);
+		backend = resolveBackend(selection);
+		selection.active.store(backend, std::memory_order_release);
+	}
+	return backend->instance();
+}
+
+bool QHotkeyPrivate::isPlatformSupported()
+{
+	BackendSelection &selection = backendSelection();
+	QMutexLocker locker(&selection.mutex);
+	return resolveBackend(selection)->isSupported();
+}
+
+bool QHotkeyPrivate::setBackend(const QString &name)
+{
+	BackendSelection &selection = backendSelection();
+	QMutexLocker locker(&selection.mutex);
+	if(const Backend *active = selection.active.load())
+		return name == QLatin1String(active->name);
+	if(!findBackend(name)) {
+		qCWarning(logQHotkey) << "Unknown hotkey backend" << name << "- available are" << availableBackends();
+		return false;
+	}
+
+	selection.requested = name;
+	return true;
+}
+
+QString QHotkeyPrivate::backendName()
+{
+	BackendSelection &selection = backendSelection();
+	QMutexLocker locker(&selection.mutex);
+	return QString::fromLatin1(resolveBackend(selection)->name);
+}
+
+QStringList QHotkeyPrivate::availableBackends()
 {
+	QStringList names;
+	for(const Backend &backend : backends)
+		names.append(QString::fromLatin1(backend.name));
+	return names;
+}
+
+QList<QHotkey::Availability> QHotkeyPrivate::probe(const QList<QKeySequence> &sequences)
+{
+	if(QThread::currentThread() != thread() && isThreadSafe())
+		return probeInvoked(sequences);
+
 	Qt::ConnectionType conType = (QThread::currentThread() == thread() ?
 									  Qt::DirectConnection :
 									  Qt::BlockingQueuedConnection);
-	QHotkey::NativeShortcut res;
-	if(!QMetaObject::invokeMethod(this, "nativeShortcutInvoked", conType,
-								  Q_RETURN_ARG(QHotkey::NativeShortcut, res),
-								  Q_ARG(Qt::Key, keycode),
-								  Q_ARG(Qt::KeyboardModifiers, modifiers))) {
-		return QHotkey::NativeShortcut();
+	QList<QHotkey::Availability> res;
+	if(!QMetaObject::invokeMethod(this, "probeInvoked", conType,
+								  Q_RETURN_ARG(QList<QHotkey::Availability>, res),
+								  Q_ARG(QList<QKeySequence>, sequences))) {
+		return QList<QHotkey::Availability>();
 	}
 	return res;
 }
 
-bool QHotkeyPrivate::addShortcut(QHotkey *hotkey)
+QList<QHotkey*> QHotkeyPrivate::hotkeysFor(QHotkey::NativeShortcut shortcut)
 {
-	if(hotkey->_registered)
-		return false;
+	// a pure lookup, so it runs on the calling thread and in parallel to other lookups
+	QReadLocker locker(registryWriter.load() == QThread::currentThreadId() ? nullptr : &registryLock);
+	QList<QHotkey*> hotkeys = shortcuts.values(shortcut) + chordHotkeys.values(shortcut);
+	for(auto it = windowShortcuts.constBegin(); it != windowShortcuts.constEnd(); ++it)
+		hotkeys += it->values(shortcut);
+	return hotkeys + activeWindowShortcuts.values(shortcut);
+}
+
+QHotkey::NativeShortcut QHotkeyPrivate::nativeShortcut(Qt::Key keycode, Qt::KeyboardModifiers modifiers)
+{
+	if(QThread::currentThread() != thread() && isThreadSafe())
+		return nativeShortcutInvoked(keycode, modifiers);
 
 	Qt::ConnectionType conType = (QThread::currentThread() == thread() ?
 									  Qt::DirectConnection :
 									  Qt::BlockingQueuedConnection);
-	bool res = false;
-	if(!QMetaObject::invokeMethod(this, "addShortcutInvoked", conType,
-								  Q_RETURN_ARG(bool, res),
-								  Q_ARG(QHotkey*, hotkey))) {
-		return false;
+	QHotkey::NativeShortcut res;
+	if(!QMetaObject::invokeMethod(this, "nativeShortcutInvoked", conType,
+								  Q_RETURN_ARG(QHotkey::NativeShortcut, res),
+								  Q_ARG(Qt::Key, keycode),
+								  Q_ARG(Qt::KeyboardModifiers, modifiers))) {
+		return QHotkey::NativeShortcut();
 	}
-
-	if(res)
-		emit hotkey->registeredChanged(true);
 	return res;
 }
 
-bool QHotkeyPrivate::removeShortcut(QHotkey *hotkey)
+bool QHotkeyPrivate::setThreadMode(bool enabled)
 {
-	if(!hotkey->_registered)
-		return false;
-
 	Qt::ConnectionType conType = (QThread::currentThread() == thread() ?
 									  Qt::DirectConnection :
 									  Qt::BlockingQueuedConnection);
 	bool res = false;
-	if(!QMetaObject::invokeMethod(this, "removeShortcutInvoked", conType,
+	if(!QMetaObject::invokeMethod(this, "setThreadModeInvoked", conType,
 								  Q_RETURN_ARG(bool, res),
-								  Q_ARG(QHotkey*, hotkey))) {
+								  Q_ARG(bool, enabled))) {
 		return false;
 	}
-
-	if(res)
-		emit hotkey->registeredChanged(false);
 	return res;
 }
 
-void QHotkeyPrivate::activateShortcut(QHotkey::NativeShortcut shortcut)
+bool QHotkeyPrivate::threadMode() const
 {
-	QMetaMethod signal = QMetaMethod::fromSignal(&QHotkey::activated);
-	for(QHotkey *hkey : shortcuts.values(shortcut))
-		signal.invoke(hkey, Qt::QueuedConnection);
+	return threadModeEnabled;
 }
 
-void QHotkeyPrivate::releaseShortcut(QHotkey::NativeShortcut shortcut)
+void QHotkeyPrivate::setStatsEnabled(bool enabled)
 {
-	QMetaMethod signal = QMetaMethod::fromSignal(&QHotkey::released);
-	for(QHotkey *hkey : shortcuts.values(shortcut))
-		signal.invoke(hkey, Qt::QueuedConnection);
+	statsEnabled = enabled;
 }
 
-void QHotkeyPrivate::addMappingInvoked(Qt::Key keycode, Qt::KeyboardModifiers modifiers, QHotkey::NativeShortcut nativeShortcut)
+bool QHotkeyPrivate::isStatsEnabled() const
 {
-	mapping.insert({keycode, modifiers}, nativeShortcut);
+	return statsEnabled;
 }
 
-bool QHotkeyPrivate::addShortcutInvoked(QHotkey *hotkey)
+QHotkeyStats::Snapshot QHotkeyPrivate::statsSnapshot()
 {
-	QHotkey::NativeShortcut shortcut = hotkey->_nativeShortcut;
+	QMutexLocker locker(&statsMutex);
+	return stats;
+}
 
-	if(!shortcuts.contains(shortcut)) {
-		if(!registerShortcut(shortcut)) {
-			qCWarning(logQHotkey) << QHotkey::tr("Failed to register %1. Error: %2").arg(hotkey->shortcut().toString(), error);
-			return false;
-		}
-	}
+void QHotkeyPrivate::resetStats()
+{
+	QMutexLocker locker(&statsMutex);
+	stats = QHotkeyStats::Snapshot();
+}
 
-	shortcuts.insert(shortcut, hotkey);
-	hotkey->_registered = true;
-	return true;
+void QHotkeyPrivate::setChordTimeout(int msecs)
+{
+	chordTimeoutMsecs = qMax(msecs, 0);
 }
 
-bool QHotkeyPrivate::removeShortcutInvoked(QHotkey *hotkey)
+int QHotkeyPrivate::chordTimeout() const
 {
-	QHotkey::NativeShortcut shortcut = hotkey->_nativeShortcut;
+	return chordTimeoutMsecs;
+}
 
-	if(shortcuts.remove(shortcut, hotkey) == 0)
-		return false;
-	hotkey->_registered = false;
-	emit hotkey->registeredChanged(true);
-	if(shortcuts.count(shortcut) == 0) {
-		if (!unregisterShortcut(shortcut)) {
+void QHotkeyPrivate::setKeyCacheFile(const QString &path)
+{
+	Qt::ConnectionType conType = (QThread::currentThread() == thread() ?
+									  Qt::DirectConnection :
+									  Qt::BlockingQueuedConnection);
+	QMetaObject::invokeMethod(this, "setKeyCacheFileInvoked", conType,
+							  Q_ARG(QString, path));
+}
+
+void QHotkeyPrivate::setUngrabDelay(int msecs)
+{
+	Qt::ConnectionType conType = (QThread::currentThread() == thread() ?
+									  Qt::DirectConnection :
+									  Qt::BlockingQueuedConnection);
+	QMetaObject::invokeMethod(this, "setUngrabDelayInvoked", conType,
+							  Q_ARG(int, msecs));
+}
+
+int QHotkeyPrivate::ungrabDelay() const
+{
+	return ungrabDelayMsecs;
+}
+
+bool QHotkeyPrivate::addShortcut(QHotkey *hotkey)
+{
+	if(hotkey->_registered)
+		return false;
+
+	bool res = false;
+	if(!runConcurrently({hotkey}, [this, hotkey, &res]() { res = addShortcutInvoked(hotkey); })) {
+		Qt::ConnectionType conType = (QThread::currentThread() == thread() ?
+										  Qt::DirectConnection :
+										  Qt::BlockingQueuedConnection);
+		if(!QMetaObject::invokeMethod(this, "addShortcutInvoked", conType,
+									  Q_RETURN_ARG(bool, res),
+									  Q_ARG(QHotkey*, hotkey))) {
+			return false;
+		}
+	}
+
+	if(res)
+		emit hotkey->registeredChanged(true);
+	return res;
+}
+
+QList<QHotkey*> QHotkeyPrivate::addShortcuts(const QList<QHotkey*> &hotkeys)
+{
+	QList<QHotkey*> pending;
+	QList<QHotkey*> failed;
+	for(QHotkey *hotkey : hotkeys) {
+		if(hotkey->_registered)
+			continue;
+		if(hotkey->_nativeShortcut.isValid())
+			pending.append(hotkey);
+		else
+			failed.append(hotkey);
+	}
+	if(pending.isEmpty())
+		return failed;
+
+	QList<QHotkey*> res;
+	if(!runConcurrently(pending, [this, &pending, &res]() { res = addShortcutsInvoked(pending); })) {
+		Qt::ConnectionType conType = (QThread::currentThread() == thread() ?
+										  Qt::DirectConnection :
+										  Qt::BlockingQueuedConnection);
+		if(!QMetaObject::invokeMethod(this, "addShortcutsInvoked", conType,
+									  Q_RETURN_ARG(QList<QHotkey*>, res),
+									  Q_ARG(QList<QHotkey*>, pending))) {
+			return failed + pending;
+		}
+	}
+
+	for(QHotkey *hotkey : pending) {
+		if(!res.contains(hotkey))
+			emit hotkey->registeredChanged(true);
+	}
+	return failed + res;
+}
+
+bool QHotkeyPrivate::removeShortcut(QHotkey *hotkey)
+{
+	if(!hotkey->_registered)
+		return false;
+
+	bool res = false;
+	if(!runConcurrently({hotkey}, [this, hotkey, &res]() { res = removeShortcutInvoked(hotkey); })) {
+		Qt::ConnectionType conType = (QThread::currentThread() == thread() ?
+										  Qt::DirectConnection :
+										  Qt::BlockingQueuedConnection);
+		if(!QMetaObject::invokeMethod(this, "removeShortcutInvoked", conType,
+									  Q_RETURN_ARG(bool, res),
+									  Q_ARG(QHotkey*, hotkey))) {
+			return false;
+		}
+	}
+
+	if(res)
+		emit hotkey->registeredChanged(false);
+	return res;
+}
+
+QList<QHotkey*> QHotkeyPrivate::removeShortcuts(const QList<QHotkey*> &hotkeys)
+{
+	QList<QHotkey*> pending;
+	for(QHotkey *hotkey : hotkeys) {
+		if(hotkey->_registered)
+			pending.append(hotkey);
+	}
+	if(pending.isEmpty())
+		return {};
+
+	QList<QHotkey*> res;
+	if(!runConcurrently(pending, [this, &pending, &res]() { res = removeShortcutsInvoked(pending); })) {
+		Qt::ConnectionType conType = (QThread::currentThread() == thread() ?
+										  Qt::DirectConnection :
+										  Qt::BlockingQueuedConnection);
+		if(!QMetaObject::invokeMethod(this, "removeShortcutsInvoked", conType,
+									  Q_RETURN_ARG(QList<QHotkey*>, res),
+									  Q_ARG(QList<QHotkey*>, pending))) {
+			return pending;
+		}
+	}
+
+	for(QHotkey *hotkey : pending) {
+		if(!hotkey->_registered)
+			emit hotkey->registeredChanged(false);
+	}
+	return res;
+}
+
+void QHotkeyPrivate::updateShortcut(QHotkey *hotkey)
+{
+	Qt::ConnectionType conType = (QThread::currentThread() == thread() ?
+									  Qt::DirectConnection :
+									  Qt::BlockingQueuedConnection);
+	QMetaObject::invokeMethod(this, "updateShortcutInvoked", conType,
+							  Q_ARG(QHotkey*, hotkey));
+}
+
+QFuture<bool> QHotkeyPrivate::addShortcutAsync(QHotkey *hotkey)
+{
+	return runAsync(hotkey, [this](QHotkey *target) -> bool {
+		if(target->_registered)
+			return true;
+		if(!target->_nativeShortcut.isValid() || !addShortcutInvoked(target))
+			return false;
+		emitRegisteredChanged(target, true);
+		return true;
+	});
+}
+
+QFuture<bool> QHotkeyPrivate::removeShortcutAsync(QHotkey *hotkey)
+{
+	return runAsync(hotkey, [this](QHotkey *target) -> bool {
+		if(!target->_registered)
+			return true;
+		if(!removeShortcutInvoked(target))
+			return false;
+		emitRegisteredChanged(target, false);
+		return true;
+	});
+}
+
+void QHotkeyPrivate::cancelAsyncCalls(QHotkey *hotkey)
+{
+	RegistryWriteLocker locker(this);
+	for(auto it = asyncCalls.begin(); it != asyncCalls.end();) {
+		if(it.value() == hotkey)
+			it = asyncCalls.erase(it);
+		else
+			++it;
+	}
+}
+
+void QHotkeyPrivate::activateShortcut(QHotkey::NativeShortcut shortcut)
+{
+	activateShortcut(QHotkeyEvent(shortcut));
+}
+
+void QHotkeyPrivate::activateShortcut(const QHotkeyEvent &event)
+{
+	if(event.window() != 0) {
+		if(isScopedEvent(event.nativeShortcut(), event.window()))
+			dispatchScoped(event, true);
+		else
+			activateShortcut(globalEvent(event));
+		return;
+	}
+	if(hasChords.load(std::memory_order_relaxed)) {
+		// the prefix tree belongs to the thread of this object
+		if(QThread::currentThread() != thread()) {
+			QMetaObject::invokeMethod(this, [this, event]() {
+				if(!processChordKey(event))
+					dispatchSignal(event.nativeShortcut(), QMetaMethod::fromSignal(&QHotkey::activated), &event);
+			}, Qt::QueuedConnection);
+			return;
+		}
+		if(processChordKey(event))
+			return;
+	}
+	dispatchSignal(event.nativeShortcut(), QMetaMethod::fromSignal(&QHotkey::activated), &event);
+}
+
+void QHotkeyPrivate::releaseShortcut(QHotkey::NativeShortcut shortcut, WId window)
+{
+	if(window != 0 && isScopedEvent(shortcut, window)) {
+		dispatchScoped(QHotkeyEvent(shortcut, shortcut.key, shortcut.modifier, 0, monotonicNsecs(), false, window), false);
+		return;
+	}
+	dispatchSignal(shortcut, QMetaMethod::fromSignal(&QHotkey::released), nullptr);
+}
+
+void QHotkeyPrivate::repeatShortcut(QHotkey::NativeShortcut shortcut)
+{
+	repeatShortcut(QHotkeyEvent(shortcut, true));
+}
+
+void QHotkeyPrivate::repeatShortcut(const QHotkeyEvent &event)
+{
+	// scoped hotkeys have no repeat policies
+	if(event.window() != 0) {
+		if(!isScopedEvent(event.nativeShortcut(), event.window()))
+			repeatShortcut(globalEvent(event));
+		return;
+	}
+
+	struct DirectRepeat {
+		QHotkey *hotkey;
+		bool coalesce;
+		int repeatCount;
+	};
+	QVarLengthArray<DirectRepeat, 8> directRepeats;
+	const QMetaMethod activatedSignal = QMetaMethod::fromSignal(&QHotkey::activated);
+	const QMetaMethod repeatedSignal = QMetaMethod::fromSignal(&QHotkey::repeated);
+
+	// repeats are filtered here, so hotkeys that ignore them or are within their interval never cost a metacall
+	const int epoch = enterDispatch();
+	const quint64 generation = dispatchGeneration.load();
+	const DispatchTable *table = dispatchTable.load();
+	const DispatchTable::Bucket *bucket = table ? table->find(event.nativeShortcut().packed()) : nullptr;
+	if(bucket) {
+		const bool canDeliverDirect = QThread::currentThread() == thread();
+		const qint64 now = event.receiveNsecs();
+		for(int i = bucket->first; i < bucket->first + bucket->count; ++i) {
+			const DispatchTable::Listener &listener = table->listeners.at(i);
+			if(listener.repeatPolicy == QHotkey::IgnoreRepeats || listener.hold)
+				continue;
+
+			QHotkey *hotkey = listener.hotkey;
+			const int repeatCount = hotkey->_repeatCount.fetch_add(1, std::memory_order_relaxed) + 1;
+			// of several dispatching threads, only the one that moves the last activation delivers
+			qint64 lastNsecs = hotkey->_lastActivationNsecs.load(std::memory_order_relaxed);
+			if(now - lastNsecs < listener.repeatIntervalNsecs ||
+			   !hotkey->_lastActivationNsecs.compare_exchange_strong(lastNsecs, now, std::memory_order_relaxed))
+				continue;
+
+			const bool coalesce = listener.repeatPolicy == QHotkey::CoalesceRepeats;
+			if(listener.direct && canDeliverDirect)
+				directRepeats.append({hotkey, coalesce, repeatCount});
+			else if(coalesce) {
+				activatedSignal.invoke(hotkey, Qt::QueuedConnection);
+				emitEvent(hotkey, event, Qt::QueuedConnection);
+			} else
+				repeatedSignal.invoke(hotkey, Qt::QueuedConnection, Q_ARG(int, repeatCount));
+		}
+	}
+	leaveDispatch(epoch);
+
+	for(const DirectRepeat &repeat : directRepeats) {
+		if(!isListening(event.nativeShortcut(), repeat.hotkey, generation))
+			continue;
+		if(repeat.coalesce) {
+			activatedSignal.invoke(repeat.hotkey, Qt::DirectConnection);
+			if(isListening(event.nativeShortcut(), repeat.hotkey, generation))
+				emitEvent(repeat.hotkey, event, Qt::DirectConnection);
+		} else
+			repeatedSignal.invoke(repeat.hotkey, Qt::DirectConnection, Q_ARG(int, repeat.repeatCount));
+	}
+}
+
+void QHotkeyPrivate::dispatchSignal(QHotkey::NativeShortcut shortcut, const QMetaMethod &signal, const QHotkeyEvent *event)
+{
+	const bool activation = event != nullptr;
+	bool hasHolds = false;
+	const bool recordStats = statsEnabled.load(std::memory_order_relaxed);
+	const qint64 entryNsecs = recordStats ? monotonicNsecs() : 0;
+	// direct listeners live on this thread, but the event might come in from a different one
+	const bool canDeliverDirect = QThread::currentThread() == thread();
+	QVarLengthArray<QHotkey*, 8> directHotkeys;
+
+	// announce the reader before loading the table, so neither the table nor its hotkeys are freed while in use.
+	// Slots are only called after leaving, so one that deletes a hotkey never waits for its own thread
+	const int epoch = enterDispatch();
+	const quint64 generation = dispatchGeneration.load();
+	const DispatchTable *table = dispatchTable.load();
+	const DispatchTable::Bucket *bucket = table ? table->find(shortcut.packed()) : nullptr;
+	if(bucket) {
+		if(Q_UNLIKELY(recordStats)) {
+			QMutexLocker locker(&statsMutex);
+			QHotkeyStats::ShortcutStats &shortcutStats = stats.shortcuts[shortcut];
+			if(activation)
+				++shortcutStats.activations;
+			else
+				++shortcutStats.releases;
+		}
+
+		for(int i = bucket->first; i < bucket->first + bucket->count; ++i) {
+			const DispatchTable::Listener &listener = table->listeners.at(i);
+			if(listener.hold) {
+				hasHolds = true;
+				continue;
+			}
+			if(activation && listener.repeatPolicy != QHotkey::IgnoreRepeats) {
+				listener.hotkey->_lastActivationNsecs.store(event->receiveNsecs(), std::memory_order_relaxed);
+				listener.hotkey->_repeatCount.store(0, std::memory_order_relaxed);
+			}
+			if(listener.direct && canDeliverDirect)
+				directHotkeys.append(listener.hotkey);
+			else if(Q_UNLIKELY(recordStats)) {
+				// measure when the queued call actually reaches the thread of the hotkey
+				QHotkey *hotkey = listener.hotkey;
+				QMetaObject::invokeMethod(hotkey, [this, shortcut, signal, entryNsecs, hotkey]() {
+					recordDelivery(shortcut, entryNsecs);
+					signal.invoke(hotkey, Qt::DirectConnection);
+				}, Qt::QueuedConnection);
+				if(activation)
+					emitEvent(hotkey, *event, Qt::QueuedConnection);
+			} else {
+				signal.invoke(listener.hotkey, Qt::QueuedConnection);
+				if(activation)
+					emitEvent(listener.hotkey, *event, Qt::QueuedConnection);
+			}
+		}
+	}
+	leaveDispatch(epoch);
+
+	for(QHotkey *hotkey : directHotkeys) {
+		if(!isListening(shortcut, hotkey, generation))
+			continue;
+		if(Q_UNLIKELY(recordStats))
+			recordDelivery(shortcut, entryNsecs);
+		signal.invoke(hotkey, Qt::DirectConnection);
+		if(activation && isListening(shortcut, hotkey, generation))
+			emitEvent(hotkey, *event, Qt::DirectConnection);
+	}
+
+	// hold thresholds are timed by the wheel, which belongs to the thread of this object
+	if(hasHolds) {
+		if(QThread::currentThread() == thread())
+			processHold(shortcut, event);
+		else if(activation) {
+			const QHotkeyEvent pressEvent = *event;
+			QMetaObject::invokeMethod(this, [this, shortcut, pressEvent]() {
+				processHold(shortcut, &pressEvent);
+			}, Qt::QueuedConnection);
+		} else {
+			QMetaObject::invokeMethod(this, [this, shortcut]() {
+				processHold(shortcut, nullptr);
+			}, Qt::QueuedConnection);
+		}
+	}
+}
+
+void QHotkeyPrivate::rebuildDispatchTable()
+{
+	const QList<QHotkey::NativeShortcut> keys = shortcuts.uniqueKeys();
+	int capacity = 8;
+	while(capacity < keys.size() * 2)
+		capacity *= 2;
+
+	auto table = new DispatchTable();
+	table->buckets.fill({EmptyDispatchKey, 0, 0}, capacity);
+	table->mask = static_cast<quint64>(capacity - 1);
+	table->listeners.reserve(shortcuts.size());
+	for(QHotkey::NativeShortcut shortcut : keys) {
+		const quint64 key = shortcut.packed();
+		quint64 index = mixShortcut(key) & table->mask;
+		while(table->buckets[index].key != EmptyDispatchKey)
+			index = (index + 1) & table->mask;
+
+		DispatchTable::Bucket &bucket = table->buckets[index];
+		bucket.key = key;
+		bucket.first = table->listeners.size();
+		bool repeats = false;
+		for(QHotkey *hotkey : shortcuts.values(shortcut)) {
+			hotkey->_dispatched = true;
+			repeats = repeats || hotkey->_repeatPolicy != QHotkey::IgnoreRepeats;
+			const bool direct = hotkey->_deliveryMode == QHotkey::DirectDelivery &&
+								hotkey->thread() == thread();
+			table->listeners.append({
+				hotkey,
+				direct,
+				hotkey->_repeatPolicy,
+				hotkey->_repeatInterval * Q_INT64_C(1000000),
+				hotkey->_holdThreshold > 0
+			});
+		}
+		bucket.count = table->listeners.size() - bucket.first;
+		setShortcutRepeats(shortcut, repeats);
+	}
+
+	// publish the new table. The old one is freed later on the thread of this object, once all readers that might
+	// still use it have left, the first retired table schedules that
+	dispatchGeneration.fetch_add(1);
+	const DispatchTable *oldTable = dispatchTable.exchange(table);
+	if(!oldTable)
+		return;
+	const DispatchTable *head = retiredTables.load();
+	do {
+		oldTable->nextRetired = head;
+	} while(!retiredTables.compare_exchange_weak(head, oldTable));
+	if(!head) {
+		QMetaObject::invokeMethod(this, [this]() {
+			reclaimDispatchTables();
+		}, Qt::QueuedConnection);
+	}
+}
+
+void QHotkeyPrivate::reclaimDispatchTables()
+{
+	// tables retired from now on schedule the next reclaim
+	const DispatchTable *table = retiredTables.exchange(nullptr);
+	if(!table)
+		return;
+	waitForDispatchers();
+	while(table) {
+		const DispatchTable *next = table->nextRetired;
+		delete table;
+		table = next;
+	}
+}
+
+int QHotkeyPrivate::enterDispatch()
+{
+	const int epoch = readerEpoch.load() & 1;
+	activeReaders[epoch].fetch_add(1);
+	return epoch;
+}
+
+void QHotkeyPrivate::leaveDispatch(int epoch)
+{
+	activeReaders[epoch].fetch_sub(1);
+}
+
+void QHotkeyPrivate::waitForDispatchers()
+{
+	// a reader that loaded the epoch right before the first flip counts itself in the old slot, so flip twice
+	QMutexLocker locker(&readerWaitMutex);
+	for(int i = 0; i < 2; ++i) {
+		const int epoch = readerEpoch.fetch_xor(1) & 1;
+		while(activeReaders[epoch].load() != 0)
+			QThread::yieldCurrentThread();
+	}
+}
+
+bool QHotkeyPrivate::isListening(QHotkey::NativeShortcut shortcut, QHotkey *hotkey, quint64 generation)
+{
+	// slots may remove or delete hotkeys, which always rebuilds the table. Only then it has to be searched again
+	if(dispatchGeneration.load() == generation)
+		return true;
+
+	bool found = false;
+	const int epoch = enterDispatch();
+	const DispatchTable *table = dispatchTable.load();
+	const DispatchTable::Bucket *bucket = table ? table->find(shortcut.packed()) : nullptr;
+	for(int i = bucket ? bucket->first : 0; bucket && !found && i < bucket->first + bucket->count; ++i)
+		found = table->listeners.at(i).hotkey == hotkey;
+	leaveDispatch(epoch);
+	return found;
+}
+
+void QHotkeyPrivate::loadKeyCache()
+{
+	keyCacheLoaded = true;
+	keyCacheHash = keyCachePath.isEmpty() ? 0 : keymapHash();
+	if(keyCacheHash == 0)
+		return;
+
+	keyCacheFile.setFileName(keyCachePath);
+	if(!keyCacheFile.open(QIODevice::ReadOnly))
+		return;//created with the first translation
+
+	const qint64 size = keyCacheFile.size();
+	const uchar *data = size >= static_cast<qint64>(sizeof(KeyCacheHeader)) ? keyCacheFile.map(0, size) : nullptr;
+	if(!data) {
+		keyCacheFile.close();
+		return;
+	}
+
+	// files of other layouts, versions or broken ones are ignored and replaced with the next write
+	KeyCacheHeader header;
+	std::memcpy(&header, data, sizeof(header));
+	if(std::memcmp(header.magic, KeyCacheMagic, sizeof(KeyCacheMagic)) != 0 ||
+	   header.version != KeyCacheVersion ||
+	   header.keymapHash != keyCacheHash ||
+	   size != static_cast<qint64>(sizeof(KeyCacheHeader) + header.count * sizeof(KeyCacheEntry))) {
+		keyCacheFile.unmap(const_cast<uchar*>(data));
+		keyCacheFile.close();
+		return;
+	}
+
+	keyCacheData = data;
+	keyCacheCount = static_cast<int>(header.count);
+}
+
+void QHotkeyPrivate::closeKeyCache()
+{
+	if(keyCacheData)
+		keyCacheFile.unmap(const_cast<uchar*>(keyCacheData));
+	keyCacheFile.close();
+	keyCacheData = nullptr;
+	keyCacheCount = 0;
+	keyCacheLoaded = false;
+}
+
+bool QHotkeyPrivate::findInKeyCache(Qt::Key keycode, Qt::KeyboardModifiers modifiers, QHotkey::NativeShortcut &shortcut) const
+{
+	const auto addition = keyCacheAdditions.constFind({keycode, modifiers});
+	if(addition != keyCacheAdditions.constEnd()) {
+		shortcut = addition.value();
+		return true;
+	}
+	if(!keyCacheData)
+		return false;
+
+	const auto entries = reinterpret_cast<const KeyCacheEntry*>(keyCacheData + sizeof(KeyCacheHeader));
+	const quint64 key = keyCacheKey(static_cast<quint32>(keycode), static_cast<quint32>(modifiers));
+	const KeyCacheEntry *entry = std::lower_bound(entries, entries + keyCacheCount, key,
+												  [](const KeyCacheEntry &candidate, quint64 key) {
+		return keyCacheKey(candidate.key, candidate.modifiers) < key;
+	});
+	if(entry == entries + keyCacheCount || keyCacheKey(entry->key, entry->modifiers) != key)
+		return false;
+
+	shortcut = QHotkey::NativeShortcut(entry->nativeKey, entry->nativeModifier);
+	return true;
+}
+
+void QHotkeyPrivate::writeKeyCache()
+{
+	RegistryWriteLocker locker(this);
+	keyCacheTimer.stop();
+	if(keyCachePath.isEmpty() || keyCacheHash == 0 || keyCacheAdditions.isEmpty())
+		return;
+
+	// merge with the current file, the key of each entry keeps them sorted
+	QMap<quint64, KeyCacheEntry> entries;
+	if(keyCacheData) {
+		const auto oldEntries = reinterpret_cast<const KeyCacheEntry*>(keyCacheData + sizeof(KeyCacheHeader));
+		for(int i = 0; i < keyCacheCount; ++i)
+			entries.insert(keyCacheKey(oldEntries[i].key, oldEntries[i].modifiers), oldEntries[i]);
+	}
+	for(auto it = keyCacheAdditions.constBegin(); it != keyCacheAdditions.constEnd(); ++it) {
+		const KeyCacheEntry entry = {
+			static_cast<quint32>(it.key().first),
+			static_cast<quint32>(it.key().second),
+			it.value().key,
+			it.value().modifier
+		};
+		entries.insert(keyCacheKey(entry.key, entry.modifiers), entry);
+	}
+
+	KeyCacheHeader header;
+	std::memcpy(header.magic, KeyCacheMagic, sizeof(KeyCacheMagic));
+	header.version = KeyCacheVersion;
+	header.count = static_cast<quint32>(entries.size());
+	header.keymapHash = keyCacheHash;
+
+	// other processes keep their mapping of the old file, as the new one is only renamed over it
+	QDir().mkpath(QFileInfo(keyCachePath).absolutePath());
+	QSaveFile file(keyCachePath);
+	if(file.open(QIODevice::WriteOnly)) {
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		for(const KeyCacheEntry &entry : entries)
+			file.write(reinterpret_cast<const char*>(&entry), sizeof(entry));
+	}
+	if(!file.commit()) {
+		qCWarning(logQHotkey) << "Failed to write the key cache" << keyCachePath << "Error:" << file.errorString();
+		return;
+	}
+
+	closeKeyCache();
+	keyCacheAdditions.clear();
+	loadKeyCache();
+}
+
+QList<QHotkey::NativeShortcut> QHotkeyPrivate::releaseGrabs(const QList<QHotkey::NativeShortcut> &shortcuts)
+{
+	const int delay = ungrabDelayMsecs;
+	if(delay <= 0)
+		return unregisterShortcuts(shortcuts);
+
+	// the dispatch table no longer knows these keys, so their events are dropped until they are reused or released
+	const qint64 deadline = monotonicNsecs() + delay * Q_INT64_C(1000000);
+	for(QHotkey::NativeShortcut shortcut : shortcuts)
+		pendingUngrabs.insert(shortcut, deadline);
+	if(!ungrabTimer.isActive())
+		ungrabTimer.start(delay);
+	return {};
+}
+
+void QHotkeyPrivate::reuseGrab(QHotkey::NativeShortcut shortcut)
+{
+	// without pending ungrabs, registrations on other threads never touch the timer
+	if(pendingUngrabs.remove(shortcut) > 0 && pendingUngrabs.isEmpty())
+		ungrabTimer.stop();
+}
+
+void QHotkeyPrivate::flushUngrabs(bool all)
+{
+	const qint64 now = monotonicNsecs();
+	qint64 nextDeadline = -1;
+	QList<QHotkey::NativeShortcut> expired;
+	for(auto it = pendingUngrabs.begin(); it != pendingUngrabs.end();) {
+		if(all || it.value() <= now) {
+			expired.append(it.key());
+			it = pendingUngrabs.erase(it);
+		} else {
+			if(nextDeadline < 0 || it.value() < nextDeadline)
+				nextDeadline = it.value();
+			++it;
+		}
+	}
+
+	if(!expired.isEmpty()) {
+		const QList<QHotkey::NativeShortcut> failed = unregisterShortcuts(expired);
+		for(int i = 0; i < failed.size(); ++i) {
+			if(statsEnabled)
+				recordUnregistrationFailure();
+			qCWarning(logQHotkey) << QHotkey::tr("Failed to release an unused shortcut. Error: %1").arg(error);
+		}
+	}
+
+	if(nextDeadline >= 0)
+		ungrabTimer.start(static_cast<int>((nextDeadline - now + 999999) / 1000000));
+	else
+		ungrabTimer.stop();
+}
+
+void QHotkeyPrivate::scheduleKeyCacheWrite()
+{
+	if(QThread::currentThread() == thread()) {
+		if(!keyCacheTimer.isActive())
+			keyCacheTimer.start();
+	} else {
+		QMetaObject::invokeMethod(this, [this]() {
+			if(!keyCacheTimer.isActive())
+				keyCacheTimer.start();
+		}, Qt::QueuedConnection);
+	}
+}
+
+void QHotkeyPrivate::flushExpiredUngrabs()
+{
+	RegistryWriteLocker locker(this);
+	flushUngrabs(false);
+}
+
+bool QHotkeyPrivate::runConcurrently(const QList<QHotkey*> &hotkeys, const std::function<void()> &registration)
+{
+	if(QThread::currentThread() == thread() || !isThreadSafe())
+		return false;
+
+	RegistryWriteLocker locker(this);
+	// everything else needs the timers, the chord tree, the hold wheel or the focus window of this thread
+	if(ungrabDelayMsecs > 0)
+		return false;
+	for(QHotkey *hotkey : hotkeys) {
+		if(hotkey->_scope != QHotkey::GlobalScope ||
+		   !hotkey->_chordShortcuts.isEmpty() ||
+		   hotkey->_holdThreshold > 0)
+			return false;
+	}
+
+	registration();
+	return true;
+}
+
+QFuture<bool> QHotkeyPrivate::runAsync(QHotkey *hotkey, const std::function<bool(QHotkey*)> &call)
+{
+	QFutureInterface<bool> result;
+	result.reportStarted();
+
+	if(QThread::currentThread() == thread()) {
+		result.reportResult(call(hotkey));
+		result.reportFinished();
+		return result.future();
+	}
+
+	hotkey->_asyncQueued = true;
+	quint64 id;
+	{
+		RegistryWriteLocker locker(this);
+		id = nextAsyncCall++;
+		asyncCalls.insert(id, hotkey);
+	}
+	// the registry stays locked while the call runs, so the destructor of the hotkey waits for it or cancels it
+	QMetaObject::invokeMethod(this, [this, id, call, result]() mutable {
+		RegistryWriteLocker locker(this);
+		QHotkey *target = asyncCalls.take(id);
+		result.reportResult(target && call(target));
+		result.reportFinished();
+	}, Qt::QueuedConnection);
+	return result.future();
+}
+
+void QHotkeyPrivate::emitRegisteredChanged(QHotkey *hotkey, bool registered)
+{
+	// the hotkey may be destroyed on its own thread as soon as the registry is unlocked, a queued signal is dropped then
+	const Qt::ConnectionType conType = hotkey->thread() == QThread::currentThread() ? Qt::DirectConnection : Qt::QueuedConnection;
+	QMetaMethod::fromSignal(&QHotkey::registeredChanged).invoke(hotkey, conType, Q_ARG(bool, registered));
+}
+
+bool QHotkeyPrivate::isGrabbed(QHotkey::NativeShortcut shortcut) const
+{
+	return shortcuts.contains(shortcut) ||
+		   chordHotkeys.contains(shortcut) ||
+		   chordGrabs.contains(shortcut) ||
+		   pendingUngrabs.contains(shortcut);
+}
+
+void QHotkeyPrivate::rebuildChordTree()
+{
+	finishChord();
+	qDeleteAll(chordRoot.children);
+	chordRoot.children.clear();
+
+	for(QHotkey *hotkey : chordHotkeys) {
+		ChordNode *node = &chordRoot;
+		QVector<QHotkey::NativeShortcut> keys;
+		keys.append(hotkey->_nativeShortcut);
+		keys.append(hotkey->_chordShortcuts);
+		for(QHotkey::NativeShortcut key : keys) {
+			ChordNode *&child = node->children[key];
+			if(!child)
+				child = new ChordNode();
+			node = child;
+		}
+		node->hotkeys.append(hotkey);
+	}
+	hasChords = !chordHotkeys.isEmpty();
+}
+
+bool QHotkeyPrivate::processChordKey(const QHotkeyEvent &event)
+{
+	const QHotkey::NativeShortcut shortcut = event.nativeShortcut();
+	if(chordState) {
+		ChordNode *next = chordState->children.value(shortcut);
+		if(next) {
+			advanceChord(next, event);
+			return true;
+		}
+		// any other key breaks the sequence, but may start a new one
+		finishChord();
+	}
+
+	ChordNode *first = chordRoot.children.value(shortcut);
+	if(first)
+		advanceChord(first, event);
+	// the first key of a sequence still reaches plain hotkeys with the same shortcut
+	return false;
+}
+
+void QHotkeyPrivate::advanceChord(ChordNode *node, const QHotkeyEvent &event)
+{
+	// a directly connected slot may change the registrations, so emit only after the node was used
+	const QList<QHotkey*> hotkeys = node->hotkeys;
+	if(node->children.isEmpty())
+		finishChord();
+	else {
+		// only the keys that can continue the sequence stay grabbed
+		RegistryWriteLocker locker(this);
+		chordState = node;
+		const QList<QHotkey::NativeShortcut> oldGrabs = chordGrabs;
+		chordGrabs.clear();
+		QList<QHotkey::NativeShortcut> newGrabs;
+		for(auto it = node->children.constBegin(); it != node->children.constEnd(); ++it) {
+			if(oldGrabs.contains(it.key()))
+				chordGrabs.append(it.key());
+			else if(pendingUngrabs.remove(it.key()) > 0)
+				chordGrabs.append(it.key());
+			else if(!isGrabbed(it.key()))
+				newGrabs.append(it.key());
+		}
+		for(QHotkey::NativeShortcut shortcut : oldGrabs) {
+			if(!isGrabbed(shortcut) && !unregisterShortcut(shortcut))
+				qCWarning(logQHotkey) << QHotkey::tr("Failed to unregister key sequence shortcut. Error: %1").arg(error);
+		}
+
+		if(!newGrabs.isEmpty()) {
+			const QList<QHotkey::NativeShortcut> failed = registerShortcuts(newGrabs);
+			for(QHotkey::NativeShortcut shortcut : newGrabs) {
+				if(failed.contains(shortcut))
+					qCWarning(logQHotkey) << QHotkey::tr("Failed to register key sequence shortcut. Error: %1").arg(error);
+				else
+					chordGrabs.append(shortcut);
+			}
+		}
+		chordTimer.start(chordTimeoutMsecs);
+	}
+
+	const QMetaMethod signal = QMetaMethod::fromSignal(&QHotkey::activated);
+	for(QHotkey *hotkey : hotkeys) {
+		const bool direct = hotkey->_deliveryMode == QHotkey::DirectDelivery &&
+							hotkey->thread() == thread();
+		signal.invoke(hotkey, direct ? Qt::DirectConnection : Qt::QueuedConnection);
+		emitEvent(hotkey, event, direct ? Qt::DirectConnection : Qt::QueuedConnection);
+	}
+}
+
+void QHotkeyPrivate::processHold(QHotkey::NativeShortcut shortcut, const QHotkeyEvent *event)
+{
+	// hotkeys with a threshold are only removed on this thread, so they stay valid after the lock is released
+	QList<QHotkey*> hotkeys;
+	{
+		RegistryWriteLocker locker(this);
+		for(QHotkey *hotkey : shortcuts.values(shortcut)) {
+			if(hotkey->_holdThreshold > 0)
+				hotkeys.append(hotkey);
+		}
+	}
+
+	for(QHotkey *hotkey : hotkeys) {
+		// a new generation invalidates the entry of the previous press, which is left in the wheel until it is due
+		++hotkey->_holdGeneration;
+		if(event)
+			scheduleHold(hotkey, *event);
+		else if(hotkey->_holdFired) {
+			hotkey->_holdFired = false;
+			const bool direct = hotkey->_deliveryMode == QHotkey::DirectDelivery &&
+								hotkey->thread() == thread();
+			QMetaMethod::fromSignal(&QHotkey::released).invoke(hotkey, direct ? Qt::DirectConnection : Qt::QueuedConnection);
+		}
+	}
+}
+
+void QHotkeyPrivate::scheduleHold(QHotkey *hotkey, const QHotkeyEvent &event)
+{
+	hotkey->_holdFired = false;
+	if(holdCount == 0) {
+		holdWheelNsecs = monotonicNsecs();
+		holdTimer.start();
+	}
+
+	const qint64 deadline = event.receiveNsecs() + hotkey->_holdThreshold * Q_INT64_C(1000000);
+	const qint64 ticks = qMax<qint64>(1, (deadline - holdWheelNsecs + HoldWheelTickNsecs - 1) / HoldWheelTickNsecs);
+	const int slot = static_cast<int>((holdWheelPos + ticks) % HoldWheelSize);
+	holdWheel[slot].append({hotkey, hotkey->_holdGeneration, static_cast<int>((ticks - 1) / HoldWheelSize), event});
+	++holdCount;
+}
+
+void QHotkeyPrivate::cancelHolds(QHotkey *hotkey)
+{
+	hotkey->_holdFired = false;
+	if(holdCount == 0 && dueHolds.isEmpty())
+		return;
+
+	for(QVector<HoldEntry> &slot : holdWheel) {
+		for(int i = slot.size() - 1; i >= 0; --i) {
+			if(slot[i].hotkey == hotkey) {
+				slot.remove(i);
+				--holdCount;
+			}
+		}
+	}
+	// the hotkey might be removed by a slot of an other hold that fired in the same tick
+	for(HoldEntry &entry : dueHolds) {
+		if(entry.hotkey == hotkey)
+			entry.hotkey = nullptr;
+	}
+	if(holdCount == 0)
+		holdTimer.stop();
+}
+
+void QHotkeyPrivate::advanceHoldWheel()
+{
+	// catch up on all ticks that passed, the timer may have been delayed
+	const qint64 now = monotonicNsecs();
+	while(holdCount > 0 && holdWheelNsecs + HoldWheelTickNsecs <= now) {
+		holdWheelNsecs += HoldWheelTickNsecs;
+		holdWheelPos = (holdWheelPos + 1) % HoldWheelSize;
+
+		QVector<HoldEntry> &slot = holdWheel[holdWheelPos];
+		for(int i = slot.size() - 1; i >= 0; --i) {
+			if(slot[i].rounds > 0)
+				--slot[i].rounds;
+			else {
+				dueHolds.append(slot[i]);
+				slot.remove(i);
+				--holdCount;
+			}
+		}
+
+		// emitted from a member, so slots that remove hotkeys can clear their entries
+		for(int i = 0; i < dueHolds.size(); ++i) {
+			QHotkey *hotkey = dueHolds[i].hotkey;
+			if(!hotkey || dueHolds[i].generation != hotkey->_holdGeneration)
+				continue;
+
+			hotkey->_holdFired = true;
+			const QHotkeyEvent event = dueHolds[i].event;
+			const bool direct = hotkey->_deliveryMode == QHotkey::DirectDelivery &&
+								hotkey->thread() == thread();
+			const Qt::ConnectionType conType = direct ? Qt::DirectConnection : Qt::QueuedConnection;
+			QMetaMethod::fromSignal(&QHotkey::activated).invoke(hotkey, conType);
+			if(dueHolds[i].hotkey)
+				emitEvent(hotkey, event, conType);
+		}
+		dueHolds.clear();
+	}
+
+	if(holdCount == 0)
+		holdTimer.stop();
+}
+
+void QHotkeyPrivate::emitEvent(QHotkey *hotkey, const QHotkeyEvent &event, Qt::ConnectionType conType)
+{
+	// most hotkeys only use activated(), so the event is only copied into a metacall if someone listens
+	static const QMetaMethod signal = QMetaMethod::fromSignal(&QHotkey::activatedEvent);
+	if(hotkey->isSignalConnected(signal))
+		signal.invoke(hotkey, conType, Q_ARG(QHotkeyEvent, event));
+}
+
+void QHotkeyPrivate::finishChord()
+{
+	RegistryWriteLocker locker(this);
+	chordTimer.stop();
+	chordState = nullptr;
+	const QList<QHotkey::NativeShortcut> grabs = chordGrabs;
+	chordGrabs.clear();
+	for(QHotkey::NativeShortcut shortcut : grabs) {
+		if(!isGrabbed(shortcut) && !unregisterShortcut(shortcut))
+			qCWarning(logQHotkey) << QHotkey::tr("Failed to unregister key sequence shortcut. Error: %1").arg(error);
+	}
+}
+
+QHotkeyPrivate::ChordNode::~ChordNode()
+{
+	qDeleteAll(children);
+}
+
+QHotkeyPrivate::RegistryWriteLocker::RegistryWriteLocker(QHotkeyPrivate *hotkeyPrivate) :
+	hotkeyPrivate(hotkeyPrivate)
+{
+	const Qt::HANDLE self = QThread::currentThreadId();
+	if(hotkeyPrivate->registryWriter.load() != self) {
+		hotkeyPrivate->registryLock.lockForWrite();
+		hotkeyPrivate->registryWriter = self;
+	}
+	++hotkeyPrivate->registryWriteDepth;
+}
+
+QHotkeyPrivate::RegistryWriteLocker::~RegistryWriteLocker()
+{
+	if(--hotkeyPrivate->registryWriteDepth == 0) {
+		hotkeyPrivate->registryWriter = nullptr;
+		hotkeyPrivate->registryLock.unlock();
+	}
+}
+
+void QHotkeyPrivate::recordRegistration(qint64 startNsecs, int count, int failures)
+{
+	const qint64 duration = monotonicNsecs() - startNsecs;
+	QMutexLocker locker(&statsMutex);
+	stats.registrationDuration.record(duration);
+	stats.registrations += static_cast<quint64>(count - failures);
+	stats.registrationFailures += static_cast<quint64>(failures);
+}
+
+void QHotkeyPrivate::recordUnregistrationFailure()
+{
+	QMutexLocker locker(&statsMutex);
+	++stats.unregistrationFailures;
+}
+
+void QHotkeyPrivate::recordDelivery(QHotkey::NativeShortcut shortcut, qint64 entryNsecs)
+{
+	const qint64 latency = monotonicNsecs() - entryNsecs;
+	QMutexLocker locker(&statsMutex);
+	stats.shortcuts[shortcut].deliveryLatency.record(latency);
+}
+
+const QHotkeyPrivate::DispatchTable::Bucket *QHotkeyPrivate::DispatchTable::find(quint64 key) const
+{
+	const Bucket *data = buckets.constData();
+	for(quint64 index = mixShortcut(key) & mask;; index = (index + 1) & mask) {
+		if(data[index].key == key)
+			return &data[index];
+		if(data[index].key == EmptyDispatchKey)
+			return nullptr;
+	}
+}
+
+void QHotkeyPrivate::addMappingInvoked(Qt::Key keycode, Qt::KeyboardModifiers modifiers, QHotkey::NativeShortcut nativeShortcut)
+{
+	RegistryWriteLocker locker(this);
+	mapping.insert({keycode, modifiers}, nativeShortcut);
+}
+
+bool QHotkeyPrivate::addShortcutInvoked(QHotkey *hotkey)
+{
+	RegistryWriteLocker locker(this);
+	if(hotkey->_scope != QHotkey::GlobalScope)
+		return addScopedShortcut(hotkey);
+
+	QHotkey::NativeShortcut shortcut = hotkey->_nativeShortcut;
+
+	if(!isGrabbed(shortcut)) {
+		const qint64 startNsecs = statsEnabled ? monotonicNsecs() : 0;
+		const bool ok = registerShortcut(shortcut);
+		if(statsEnabled)
+			recordRegistration(startNsecs, 1, ok ? 0 : 1);
+		if(!ok) {
+			qCWarning(logQHotkey) << QHotkey::tr("Failed to register %1. Error: %2").arg(hotkey->shortcut().toString(), error);
+			return false;
+		}
+	}
+
+	reuseGrab(shortcut);
+	hotkey->_registered = true;
+	if(!hotkey->_chordShortcuts.isEmpty()) {
+		chordHotkeys.insert(shortcut, hotkey);
+		rebuildChordTree();
+	} else {
+		shortcuts.insert(shortcut, hotkey);
+		rebuildDispatchTable();
+	}
+	return true;
+}
+
+QList<QHotkey*> QHotkeyPrivate::addShortcutsInvoked(const QList<QHotkey*> &hotkeys)
+{
+	RegistryWriteLocker locker(this);
+	// collect every shortcut that is not grabbed yet, so they can be registered in one go
+	QList<QHotkey::NativeShortcut> newShortcuts;
+	QSet<QHotkey::NativeShortcut> seen;
+	for(QHotkey *hotkey : hotkeys) {
+		QHotkey::NativeShortcut shortcut = hotkey->_nativeShortcut;
+		if(hotkey->_scope != QHotkey::GlobalScope)
+			continue;
+		if(!isGrabbed(shortcut) && !seen.contains(shortcut)) {
+			seen.insert(shortcut);
+			newShortcuts.append(shortcut);
+		}
+	}
+
+	const qint64 startNsecs = statsEnabled ? monotonicNsecs() : 0;
+	const QList<QHotkey::NativeShortcut> failedShortcuts = newShortcuts.isEmpty() ?
+															   QList<QHotkey::NativeShortcut>() :
+															   registerShortcuts(newShortcuts);
+	if(statsEnabled && !newShortcuts.isEmpty())
+		recordRegistration(startNsecs, newShortcuts.size(), failedShortcuts.size());
+
+	QList<QHotkey*> failed;
+	bool addedChords = false;
+	for(QHotkey *hotkey : hotkeys) {
+		if(hotkey->_registered)
+			continue;
+		if(hotkey->_scope != QHotkey::GlobalScope) {
+			if(!addScopedShortcut(hotkey))
+				failed.append(hotkey);
+			continue;
+		}
+		if(failedShortcuts.contains(hotkey->_nativeShortcut)) {
+			qCWarning(logQHotkey) << QHotkey::tr("Failed to register %1. Error: %2").arg(hotkey->shortcut().toString(), error);
+			failed.append(hotkey);
+			continue;
+		}
+
+		reuseGrab(hotkey->_nativeShortcut);
+		if(!hotkey->_chordShortcuts.isEmpty()) {
+			chordHotkeys.insert(hotkey->_nativeShortcut, hotkey);
+			addedChords = true;
+		} else
+			shortcuts.insert(hotkey->_nativeShortcut, hotkey);
+		hotkey->_registered = true;
+	}
+	rebuildDispatchTable();
+	if(addedChords)
+		rebuildChordTree();
+	return failed;
+}
+
+bool QHotkeyPrivate::removeShortcutInvoked(QHotkey *hotkey)
+{
+	RegistryWriteLocker locker(this);
+	if(hotkey->_scope != QHotkey::GlobalScope)
+		return removeScopedShortcut(hotkey);
+
+	QHotkey::NativeShortcut shortcut = hotkey->_nativeShortcut;
+
+	if(!hotkey->_chordShortcuts.isEmpty()) {
+		if(chordHotkeys.remove(shortcut, hotkey) == 0)
+			return false;
+		rebuildChordTree();
+	} else {
+		if(shortcuts.remove(shortcut, hotkey) == 0)
+			return false;
+		rebuildDispatchTable();
+	}
+	hotkey->_registered = false;
+	if(hotkey->_holdThreshold > 0)
+		cancelHolds(hotkey);
+	if(!isGrabbed(shortcut)) {
+		if (!releaseGrabs({shortcut}).isEmpty()) {
+			if(statsEnabled)
+				recordUnregistrationFailure();
 			qCWarning(logQHotkey) << QHotkey::tr("Failed to unregister %1. Error: %2").arg(hotkey->shortcut().toString(), error);
 			return false;
 		}
@@ -319,59 +1971,779 @@ bool QHotkeyPrivate::removeShortcutInvoked(QHotkey *hotkey)
 	return true;
 }
 
+QList<QHotkey*> QHotkeyPrivate::removeShortcutsInvoked(const QList<QHotkey*> &hotkeys)
+{
+	RegistryWriteLocker locker(this);
+	QList<QHotkey*> failed;
+	QList<QHotkey*> removed;
+	QSet<QHotkey::NativeShortcut> candidates;
+	bool removedPlain = false;
+	bool removedChords = false;
+	for(QHotkey *hotkey : hotkeys) {
+		const QHotkey::NativeShortcut shortcut = hotkey->_nativeShortcut;
+		if(hotkey->_scope != QHotkey::GlobalScope) {
+			if(!removeScopedShortcut(hotkey))
+				failed.append(hotkey);
+			continue;
+		}
+		if(!hotkey->_chordShortcuts.isEmpty()) {
+			if(chordHotkeys.remove(shortcut, hotkey) == 0) {
+				failed.append(hotkey);
+				continue;
+			}
+			removedChords = true;
+		} else {
+			if(shortcuts.remove(shortcut, hotkey) == 0) {
+				failed.append(hotkey);
+				continue;
+			}
+			removedPlain = true;
+		}
+		hotkey->_registered = false;
+		if(hotkey->_holdThreshold > 0)
+			cancelHolds(hotkey);
+		removed.append(hotkey);
+		candidates.insert(shortcut);
+	}
+	if(removedPlain)
+		rebuildDispatchTable();
+	if(removedChords)
+		rebuildChordTree();
+
+	// only release the keys no other hotkey uses anymore, all in one go
+	QList<QHotkey::NativeShortcut> unused;
+	for(QHotkey::NativeShortcut shortcut : candidates) {
+		if(!isGrabbed(shortcut))
+			unused.append(shortcut);
+	}
+	if(unused.isEmpty())
+		return failed;
+
+	const QList<QHotkey::NativeShortcut> failedShortcuts = releaseGrabs(unused);
+	for(QHotkey *hotkey : removed) {
+		if(failedShortcuts.contains(hotkey->_nativeShortcut)) {
+			if(statsEnabled)
+				recordUnregistrationFailure();
+			qCWarning(logQHotkey) << QHotkey::tr("Failed to unregister %1. Error: %2").arg(hotkey->shortcut().toString(), error);
+			failed.append(hotkey);
+		}
+	}
+	return failed;
+}
+
+void QHotkeyPrivate::updateShortcutInvoked(QHotkey *hotkey)
+{
+	RegistryWriteLocker locker(this);
+	if(!hotkey->_registered)
+		return;
+	// without a threshold, the hotkey may be removed from any thread, so no hold may be left in the wheel
+	if(hotkey->_holdThreshold == 0)
+		cancelHolds(hotkey);
+	rebuildDispatchTable();
+}
+
+bool QHotkeyPrivate::setThreadModeInvoked(bool enabled)
+{
+	RegistryWriteLocker locker(this);
+	if(enabled == threadModeEnabled)
+		return true;
+	// the grabs belong to the connection they were made on, so they cannot be moved
+	flushUngrabs(true);
+	if(!shortcuts.isEmpty() || !chordHotkeys.isEmpty() || hasScopedShortcuts()) {
+		qCWarning(logQHotkey) << "Unable to change the backend thread mode while hotkeys are registered";
+		return false;
+	}
+	if(!setListenerThread(enabled)) {
+		qCWarning(logQHotkey) << QHotkey::tr("Failed to change the backend thread mode. Error: %1").arg(error);
+		return false;
+	}
+
+	threadModeEnabled = enabled;
+	return true;
+}
+
+void QHotkeyPrivate::setKeyCacheFileInvoked(const QString &path)
+{
+	RegistryWriteLocker locker(this);
+	if(keyCacheTimer.isActive())
+		writeKeyCache();
+	closeKeyCache();
+	keyCacheAdditions.clear();
+	keyCachePath = path;
+}
+
+void QHotkeyPrivate::setUngrabDelayInvoked(int msecs)
+{
+	RegistryWriteLocker locker(this);
+	ungrabDelayMsecs = qMax(msecs, 0);
+	if(ungrabDelayMsecs == 0)
+		flushUngrabs(true);
+}
+
+quint64 QHotkeyPrivate::keymapHash()
+{
+	return 0;
+}
+
+void QHotkeyPrivate::setShortcutRepeats(QHotkey::NativeShortcut shortcut, bool repeats)
+{
+	Q_UNUSED(shortcut)
+	Q_UNUSED(repeats)
+}
+
+bool QHotkeyPrivate::setListenerThread(bool enabled)
+{
+	if(enabled) {
+		error = QStringLiteral("A dedicated hotkey thread is not supported on this platform");
+		return false;
+	}
+	return true;
+}
+
+bool QHotkeyPrivate::isThreadSafe() const
+{
+	return false;
+}
+
+void QHotkeyPrivate::traceEvent(const void *message, int size)
+{
+	if(Q_LIKELY(!tracing.load(std::memory_order_relaxed)))
+		return;
+	QMutexLocker locker(&traceMutex);
+	if(traceRecorder)
+		traceRecorder->recordEvent(message, size);
+}
+
+QByteArray QHotkeyPrivate::traceEventType() const
+{
+	return QByteArray();
+}
+
+void QHotkeyPrivate::prepareReplay(QByteArray &message)
+{
+	Q_UNUSED(message)
+}
+
+bool QHotkeyPrivate::attachTrace(QHotkeyTrace *trace)
+{
+	QMutexLocker locker(&traceMutex);
+	if(traceRecorder)
+		return false;
+	traceRecorder = trace;
+	tracing.store(true, std::memory_order_relaxed);
+	return true;
+}
+
+void QHotkeyPrivate::detachTrace(QHotkeyTrace *trace)
+{
+	QMutexLocker locker(&traceMutex);
+	if(traceRecorder != trace)
+		return;
+	traceRecorder = nullptr;
+	tracing.store(false, std::memory_order_relaxed);
+}
+
+bool QHotkeyPrivate::replayEvent(const QByteArray &eventType, void *message)
+{
+	_NATIVE_EVENT_RESULT result = 0;
+	return nativeEventFilter(eventType, message, &result);
+}
+
+QList<QHotkey::NativeShortcut> QHotkeyPrivate::registerShortcuts(const QList<QHotkey::NativeShortcut> &shortcuts)
+{
+	QList<QHotkey::NativeShortcut> failed;
+	for(QHotkey::NativeShortcut shortcut : shortcuts) {
+		if(!registerShortcut(shortcut))
+			failed.append(shortcut);
+	}
+	return failed;
+}
+
+QList<QHotkey::NativeShortcut> QHotkeyPrivate::unregisterShortcuts(const QList<QHotkey::NativeShortcut> &shortcuts)
+{
+	QList<QHotkey::NativeShortcut> failed;
+	for(QHotkey::NativeShortcut shortcut : shortcuts) {
+		if(!unregisterShortcut(shortcut))
+			failed.append(shortcut);
+	}
+	return failed;
+}
+
+QList<QHotkey::NativeShortcut> QHotkeyPrivate::registerWindowShortcuts(const QList<QHotkey::NativeShortcut> &shortcuts, WId window)
+{
+	Q_UNUSED(window)
+	error = QStringLiteral("Scoped hotkeys are not supported by this backend");
+	return shortcuts;
+}
+
+QList<QHotkey::NativeShortcut> QHotkeyPrivate::unregisterWindowShortcuts(const QList<QHotkey::NativeShortcut> &shortcuts, WId window)
+{
+	Q_UNUSED(window)
+	error = QStringLiteral("Scoped hotkeys are not supported by this backend");
+	return shortcuts;
+}
+
+bool QHotkeyPrivate::addScopedShortcut(QHotkey *hotkey)
+{
+	const QHotkey::NativeShortcut shortcut = hotkey->_nativeShortcut;
+	if(!hotkey->_chordShortcuts.isEmpty()) {
+		qCWarning(logQHotkey) << QHotkey::tr("Failed to register %1. Error: %2").arg(hotkey->shortcut().toString(), QStringLiteral("Key sequences cannot be scoped"));
+		return false;
+	}
+
+	// without a focus window, active window hotkeys are grabbed once one of the windows gets the focus
+	const WId window = hotkey->_scope == QHotkey::WindowScope ? hotkey->_scopeWindow : activeWindow;
+	if(window != 0 && !isWindowGrabbed(shortcut, window) &&
+	   !registerWindowShortcuts({shortcut}, window).isEmpty()) {
+		qCWarning(logQHotkey) << QHotkey::tr("Failed to register %1. Error: %2").arg(hotkey->shortcut().toString(), error);
+		return false;
+	}
+
+	if(hotkey->_scope == QHotkey::WindowScope)
+		windowShortcuts[window].insert(shortcut, hotkey);
+	else
+		activeWindowShortcuts.insert(shortcut, hotkey);
+	hasScoped = true;
+	hotkey->_registered = true;
+	return true;
+}
+
+bool QHotkeyPrivate::removeScopedShortcut(QHotkey *hotkey)
+{
+	const QHotkey::NativeShortcut shortcut = hotkey->_nativeShortcut;
+	WId window = 0;
+	if(hotkey->_scope == QHotkey::WindowScope) {
+		window = hotkey->_scopeWindow;
+		auto it = windowShortcuts.find(window);
+		if(it == windowShortcuts.end() || it->remove(shortcut, hotkey) == 0)
+			return false;
+		if(it->isEmpty())
+			windowShortcuts.erase(it);
+	} else {
+		if(activeWindowShortcuts.remove(shortcut, hotkey) == 0)
+			return false;
+		window = activeWindow;
+	}
+	hotkey->_registered = false;
+	hasScoped = hasScopedShortcuts();
+
+	if(window != 0 && !isWindowGrabbed(shortcut, window) &&
+	   !unregisterWindowShortcuts({shortcut}, window).isEmpty()) {
+		if(statsEnabled)
+			recordUnregistrationFailure();
+		qCWarning(logQHotkey) << QHotkey::tr("Failed to unregister %1. Error: %2").arg(hotkey->shortcut().toString(), error);
+		return false;
+	}
+	return true;
+}
+
+bool QHotkeyPrivate::isWindowGrabbed(QHotkey::NativeShortcut shortcut, WId window) const
+{
+	const auto it = windowShortcuts.constFind(window);
+	if(it != windowShortcuts.constEnd() && it->contains(shortcut))
+		return true;
+	return window == activeWindow && activeWindowShortcuts.contains(shortcut);
+}
+
+bool QHotkeyPrivate::hasScopedShortcuts() const
+{
+	return !windowShortcuts.isEmpty() || !activeWindowShortcuts.isEmpty();
+}
+
+bool QHotkeyPrivate::isScopedEvent(QHotkey::NativeShortcut shortcut, WId window)
+{
+	if(!hasScoped.load(std::memory_order_relaxed))
+		return false;
+	QReadLocker locker(registryWriter.load() == QThread::currentThreadId() ? nullptr : &registryLock);
+	return isWindowGrabbed(shortcut, window);
+}
+
+bool QHotkeyPrivate::hasListeners(QHotkey::NativeShortcut shortcut, WId window)
+{
+	// events of the root window always belong to a grab. Key sequences grab their following keys temporarily
+	if(window == 0 || hasChords.load(std::memory_order_relaxed) || isScopedEvent(shortcut, window))
+		return true;
+	const int epoch = enterDispatch();
+	const DispatchTable *table = dispatchTable.load();
+	const bool found = table && table->find(shortcut.packed());
+	leaveDispatch(epoch);
+	return found;
+}
+
+void QHotkeyPrivate::dispatchScoped(const QHotkeyEvent &event, bool activation)
+{
+	// the per window index belongs to the thread of this object
+	if(QThread::currentThread() != thread()) {
+		QMetaObject::invokeMethod(this, [this, event, activation]() {
+			dispatchScoped(event, activation);
+		}, Qt::QueuedConnection);
+		return;
+	}
+
+	const QHotkey::NativeShortcut shortcut = event.nativeShortcut();
+	QList<QHotkey*> hotkeys;
+	const auto it = windowShortcuts.constFind(event.window());
+	if(it != windowShortcuts.constEnd())
+		hotkeys = it->values(shortcut);
+	if(event.window() == activeWindow)
+		hotkeys += activeWindowShortcuts.values(shortcut);
+
+	const QMetaMethod signal = activation ?
+								   QMetaMethod::fromSignal(&QHotkey::activated) :
+								   QMetaMethod::fromSignal(&QHotkey::released);
+	for(QHotkey *hotkey : hotkeys) {
+		const bool direct = hotkey->_deliveryMode == QHotkey::DirectDelivery &&
+							hotkey->thread() == thread();
+		const Qt::ConnectionType conType = direct ? Qt::DirectConnection : Qt::QueuedConnection;
+		signal.invoke(hotkey, conType);
+		if(activation)
+			emitEvent(hotkey, event, conType);
+	}
+}
+
+void QHotkeyPrivate::focusWindowChanged()
+{
+	QWindow *focusWindow = QGuiApplication::focusWindow();
+	const WId window = focusWindow ? focusWindow->winId() : 0;
+	if(window == activeWindow)
+		return;
+
+	RegistryWriteLocker locker(this);
+	const WId oldWindow = activeWindow;
+	activeWindow = window;
+	if(activeWindowShortcuts.isEmpty())
+		return;
+
+	// move the grabs of the active window hotkeys along with the focus, all keys at once
+	const QList<QHotkey::NativeShortcut> keys = activeWindowShortcuts.uniqueKeys();
+	const auto oldIt = windowShortcuts.constFind(oldWindow);
+	const auto newIt = windowShortcuts.constFind(window);
+	QList<QHotkey::NativeShortcut> released;
+	QList<QHotkey::NativeShortcut> grabbed;
+	for(QHotkey::NativeShortcut shortcut : keys) {
+		if(oldWindow != 0 && (oldIt == windowShortcuts.constEnd() || !oldIt->contains(shortcut)))
+			released.append(shortcut);
+		if(window != 0 && (newIt == windowShortcuts.constEnd() || !newIt->contains(shortcut)))
+			grabbed.append(shortcut);
+	}
+	// the old window might be gone already, which took its grabs with it
+	if(!released.isEmpty())
+		unregisterWindowShortcuts(released, oldWindow);
+	if(!grabbed.isEmpty() && !registerWindowShortcuts(grabbed, window).isEmpty())
+		qCWarning(logQHotkey) << QHotkey::tr("Failed to register active window hotkeys. Error: %1").arg(error);
+}
+
+void QHotkeyPrivate::remapShortcuts()
+{
+	RegistryWriteLocker locker(this);
+	// unused grabs of the previous layout are never reused
+	flushUngrabs(true);
+
+	// cached translations of the previous layout are useless now
+	if(keyCacheLoaded) {
+		keyCacheTimer.stop();
+		keyCacheAdditions.clear();
+		closeKeyCache();
+	}
+
+	QList<QHotkey*> lostHotkeys;
+	remapScopedShortcuts(lostHotkeys);
+
+	// translate all hotkeys that were created from Qt keys again, native ones stay as they are
+	QMultiHash<QHotkey::NativeShortcut, QHotkey*> remapped;
+	bool changed = false;
+	for(auto it = shortcuts.constBegin(); it != shortcuts.constEnd(); ++it) {
+		QHotkey *hotkey = it.value();
+		QHotkey::NativeShortcut shortcut = it.key();
+		if(hotkey->_keyCode != Qt::Key_unknown) {
+			const QHotkey::NativeShortcut newShortcut = nativeShortcutInvoked(hotkey->_keyCode, hotkey->_modifiers);
+			if(newShortcut.isValid() && newShortcut != shortcut) {
+				shortcut = newShortcut;
+				changed = true;
+			}
+		}
+		remapped.insert(shortcut, hotkey);
+	}
+	if(!changed) {
+		for(QHotkey *hotkey : lostHotkeys)
+			emit hotkey->registeredChanged(false);
+		return;
+	}
+
+	QList<QHotkey::NativeShortcut> newShortcuts;
+	for(QHotkey::NativeShortcut shortcut : remapped.uniqueKeys()) {
+		if(!isGrabbed(shortcut))
+			newShortcuts.append(shortcut);
+	}
+
+	for(QHotkey::NativeShortcut shortcut : shortcuts.uniqueKeys()) {
+		if(remapped.contains(shortcut) || chordHotkeys.contains(shortcut) || chordGrabs.contains(shortcut))
+			continue;
+		if(!unregisterShortcut(shortcut))
+			qCWarning(logQHotkey) << QHotkey::tr("Failed to unregister remapped shortcut. Error: %1").arg(error);
+	}
+
+	const QList<QHotkey::NativeShortcut> failedShortcuts = newShortcuts.isEmpty() ?
+															   QList<QHotkey::NativeShortcut>() :
+															   registerShortcuts(newShortcuts);
+	for(auto it = remapped.begin(); it != remapped.end();) {
+		QHotkey *hotkey = it.value();
+		hotkey->_nativeShortcut = it.key();
+		if(failedShortcuts.contains(it.key())) {
+			qCWarning(logQHotkey) << QHotkey::tr("Failed to register %1 after a keyboard layout change. Error: %2").arg(hotkey->shortcut().toString(), error);
+			hotkey->_registered = false;
+			lostHotkeys.append(hotkey);
+			it = remapped.erase(it);
+		} else
+			++it;
+	}
+
+	shortcuts = remapped;
+	rebuildDispatchTable();
+	for(QHotkey *hotkey : lostHotkeys)
+		emit hotkey->registeredChanged(false);
+}
+
+void QHotkeyPrivate::remapScopedShortcuts(QList<QHotkey*> &lostHotkeys)
+{
+	if(!hasScopedShortcuts())
+		return;
+
+	const auto remap = [this](const QMultiHash<QHotkey::NativeShortcut, QHotkey*> &hotkeys) -> QMultiHash<QHotkey::NativeShortcut, QHotkey*> {
+		QMultiHash<QHotkey::NativeShortcut, QHotkey*> remapped;
+		for(auto it = hotkeys.constBegin(); it != hotkeys.constEnd(); ++it) {
+			QHotkey *hotkey = it.value();
+			QHotkey::NativeShortcut shortcut = it.key();
+			if(hotkey->_keyCode != Qt::Key_unknown) {
+				const QHotkey::NativeShortcut newShortcut = nativeShortcutInvoked(hotkey->_keyCode, hotkey->_modifiers);
+				if(newShortcut.isValid())
+					shortcut = newShortcut;
+			}
+			remapped.insert(shortcut, hotkey);
+		}
+		return remapped;
+	};
+	QHash<WId, QMultiHash<QHotkey::NativeShortcut, QHotkey*>> newWindowShortcuts;
+	for(auto it = windowShortcuts.constBegin(); it != windowShortcuts.constEnd(); ++it)
+		newWindowShortcuts.insert(it.key(), remap(it.value()));
+	QMultiHash<QHotkey::NativeShortcut, QHotkey*> newActiveWindowShortcuts = remap(activeWindowShortcuts);
+
+	// the grabs of a window are shared by its own hotkeys and, while it has the focus, the active window ones
+	const auto grabsOf = [this](WId window,
+								const QHash<WId, QMultiHash<QHotkey::NativeShortcut, QHotkey*>> &perWindow,
+								const QMultiHash<QHotkey::NativeShortcut, QHotkey*> &active) -> QSet<QHotkey::NativeShortcut> {
+		QSet<QHotkey::NativeShortcut> keys;
+		const auto it = perWindow.constFind(window);
+		if(it != perWindow.constEnd()) {
+			for(QHotkey::NativeShortcut shortcut : it->uniqueKeys())
+				keys.insert(shortcut);
+		}
+		if(window == activeWindow) {
+			for(QHotkey::NativeShortcut shortcut : active.uniqueKeys())
+				keys.insert(shortcut);
+		}
+		return keys;
+	};
+	QList<WId> windows = windowShortcuts.keys();
+	if(activeWindow != 0 && !activeWindowShortcuts.isEmpty() && !windowShortcuts.contains(activeWindow))
+		windows.append(activeWindow);
+
+	for(WId window : windows) {
+		if(window == 0)
+			continue;
+		const QSet<QHotkey::NativeShortcut> oldKeys = grabsOf(window, windowShortcuts, activeWindowShortcuts);
+		const QSet<QHotkey::NativeShortcut> newKeys = grabsOf(window, newWindowShortcuts, newActiveWindowShortcuts);
+		const QList<QHotkey::NativeShortcut> released = (oldKeys - newKeys).values();
+		if(!released.isEmpty() && !unregisterWindowShortcuts(released, window).isEmpty())
+			qCWarning(logQHotkey) << QHotkey::tr("Failed to unregister remapped shortcut. Error: %1").arg(error);
+
+		const QList<QHotkey::NativeShortcut> added = (newKeys - oldKeys).values();
+		const QList<QHotkey::NativeShortcut> failedShortcuts = added.isEmpty() ?
+																   QList<QHotkey::NativeShortcut>() :
+																   registerWindowShortcuts(added, window);
+		for(QHotkey::NativeShortcut shortcut : failedShortcuts) {
+			QList<QHotkey*> failedHotkeys;
+			auto it = newWindowShortcuts.find(window);
+			if(it != newWindowShortcuts.end()) {
+				failedHotkeys += it->values(shortcut);
+				it->remove(shortcut);
+			}
+			if(window == activeWindow) {
+				failedHotkeys += newActiveWindowShortcuts.values(shortcut);
+				newActiveWindowShortcuts.remove(shortcut);
+			}
+			for(QHotkey *hotkey : failedHotkeys) {
+				qCWarning(logQHotkey) << QHotkey::tr("Failed to register %1 after a keyboard layout change. Error: %2").arg(hotkey->shortcut().toString(), error);
+				hotkey->_nativeShortcut = shortcut;
+				hotkey->_registered = false;
+				lostHotkeys.append(hotkey);
+			}
+		}
+	}
+
+	for(auto it = newWindowShortcuts.begin(); it != newWindowShortcuts.end();) {
+		for(auto hotkey = it->constBegin(); hotkey != it->constEnd(); ++hotkey)
+			hotkey.value()->_nativeShortcut = hotkey.key();
+		if(it->isEmpty())
+			it = newWindowShortcuts.erase(it);
+		else
+			++it;
+	}
+	for(auto it = newActiveWindowShortcuts.constBegin(); it != newActiveWindowShortcuts.constEnd(); ++it)
+		it.value()->_nativeShortcut = it.key();
+	windowShortcuts = newWindowShortcuts;
+	activeWindowShortcuts = newActiveWindowShortcuts;
+	hasScoped = hasScopedShortcuts();
+}
+
 QHotkey::NativeShortcut QHotkeyPrivate::nativeShortcutInvoked(Qt::Key keycode, Qt::KeyboardModifiers modifiers)
 {
+	RegistryWriteLocker locker(this);
 	if(mapping.contains({keycode, modifiers}))
 		return mapping.value({keycode, modifiers});
 
+	if(!keyCacheLoaded)
+		loadKeyCache();
+	QHotkey::NativeShortcut cached;
+	if(keyCacheHash != 0 && findInKeyCache(keycode, modifiers, cached))
+		return cached;
+
 	bool ok1 = false;
 	auto k = nativeKeycode(keycode, ok1);
 	bool ok2 = false;
 	auto m = nativeModifiers(modifiers, ok2);
-	if(ok1 && ok2)
+	if(ok1 && ok2) {
+		if(keyCacheHash != 0 && !keyCachePath.isEmpty()) {
+			keyCacheAdditions.insert({keycode, modifiers}, {k, m});
+			scheduleKeyCacheWrite();
+		}
 		return {k, m};
+	}
 	return {};
 }
 
+QList<QHotkey::Availability> QHotkeyPrivate::probeInvoked(const QList<QKeySequence> &sequences)
+{
+	RegistryWriteLocker locker(this);
+	QList<QHotkey::Availability> result;
+	result.reserve(sequences.size());
+	QVector<QHotkey::NativeShortcut> nativeShortcuts;
+	nativeShortcuts.reserve(sequences.size());
+	QList<QHotkey::NativeShortcut> candidates;
+	QSet<QHotkey::NativeShortcut> seen;
+	for(const QKeySequence &sequence : sequences) {
+		// every key of a chord must be translatable, but only the first one is grabbed permanently
+		QHotkey::NativeShortcut first;
+		for(int i = 0; i < sequence.count(); ++i) {
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+			const int key = sequence[i].toCombined();
+#else
+			const int key = sequence[i];
+#endif
+			const Qt::Key keyCode = Qt::Key(key & ~Qt::KeyboardModifierMask);
+			const Qt::KeyboardModifiers modifiers = Qt::KeyboardModifiers(key & Qt::KeyboardModifierMask) & ~ownModifier(keyCode);
+			const QHotkey::NativeShortcut shortcut = nativeShortcutInvoked(keyCode, modifiers);
+			if(!shortcut.isValid()) {
+				first = QHotkey::NativeShortcut();
+				break;
+			}
+			if(i == 0)
+				first = shortcut;
+		}
+		nativeShortcuts.append(first);
+
+		if(!first.isValid())
+			result.append(QHotkey::Unsupported);
+		else if(shortcuts.contains(first) || chordHotkeys.contains(first))
+			result.append(QHotkey::InUse);
+		else {
+			// keys grabbed for a running chord or kept after their last hotkey are ours already
+			if(!isGrabbed(first) && !seen.contains(first)) {
+				seen.insert(first);
+				candidates.append(first);
+			}
+			result.append(QHotkey::Available);
+		}
+	}
+	if(candidates.isEmpty())
+		return result;
+
+	// grab and release all free keys in one batch, a backend that pipelines its requests needs only two round-trips
+	QSet<QHotkey::NativeShortcut> taken;
+	for(QHotkey::NativeShortcut shortcut : registerShortcuts(candidates))
+		taken.insert(shortcut);
+	QList<QHotkey::NativeShortcut> grabbed;
+	for(QHotkey::NativeShortcut shortcut : candidates) {
+		if(!taken.contains(shortcut))
+			grabbed.append(shortcut);
+	}
+	if(!grabbed.isEmpty() && !unregisterShortcuts(grabbed).isEmpty())
+		qCWarning(logQHotkey) << QHotkey::tr("Failed to release probed shortcuts. Error: %1").arg(error);
+
+	if(!taken.isEmpty()) {
+		for(int i = 0; i < result.size(); ++i) {
+			if(result[i] == QHotkey::Available && taken.contains(nativeShortcuts[i]))
+				result[i] = QHotkey::Taken;
+		}
+	}
+	return result;
+}
+
 
 
-QHotkey::NativeShortcut::NativeShortcut() :
-	key(),
-	modifier(),
-	valid(false)
+QHotkeyEvent::QHotkeyEvent() :
+	_shortcut(),
+	_nativeKeycode(0),
+	_nativeState(0),
+	_timestamp(0),
+	_receiveNsecs(0),
+	_repeat(false),
+	_window(0)
+{}
+
+QHotkeyEvent::QHotkeyEvent(QHotkey::NativeShortcut shortcut, bool repeat) :
+	_shortcut(shortcut),
+	_nativeKeycode(shortcut.key),
+	_nativeState(shortcut.modifier),
+	_timestamp(0),
+	_receiveNsecs(monotonicNsecs()),
+	_repeat(repeat),
+	_window(0)
+{}
+
+QHotkeyEvent::QHotkeyEvent(QHotkey::NativeShortcut shortcut, quint32 nativeKeycode, quint32 nativeState, quint64 timestamp, qint64 receiveNsecs, bool repeat, WId window) :
+	_shortcut(shortcut),
+	_nativeKeycode(nativeKeycode),
+	_nativeState(nativeState),
+	_timestamp(timestamp),
+	_receiveNsecs(receiveNsecs),
+	_repeat(repeat),
+	_window(window)
 {}
 
-QHotkey::NativeShortcut::NativeShortcut(quint32 key, quint32 modifier) :
-	key(key),
-	modifier(modifier),
-	valid(true)
+QHotkey::NativeShortcut QHotkeyEvent::nativeShortcut() const
+{
+	return _shortcut;
+}
+
+quint32 QHotkeyEvent::nativeKeycode() const
+{
+	return _nativeKeycode;
+}
+
+quint32 QHotkeyEvent::nativeState() const
+{
+	return _nativeState;
+}
+
+quint64 QHotkeyEvent::timestamp() const
+{
+	return _timestamp;
+}
+
+qint64 QHotkeyEvent::receiveNsecs() const
+{
+	return _receiveNsecs;
+}
+
+bool QHotkeyEvent::isRepeat() const
+{
+	return _repeat;
+}
+
+WId QHotkeyEvent::window() const
+{
+	return _window;
+}
+
+qint64 QHotkeyEvent::currentNsecs()
+{
+	return monotonicNsecs();
+}
+
+
+
+void QHotkeyStats::setEnabled(bool enabled)
+{
+	QHotkeyPrivate::instance()->setStatsEnabled(enabled);
+}
+
+bool QHotkeyStats::isEnabled()
+{
+	return QHotkeyPrivate::instance()->isStatsEnabled();
+}
+
+QHotkeyStats::Snapshot QHotkeyStats::snapshot()
+{
+	return QHotkeyPrivate::instance()->statsSnapshot();
+}
+
+void QHotkeyStats::reset()
+{
+	QHotkeyPrivate::instance()->resetStats();
+}
+
+QHotkeyStats::Histogram::Histogram() :
+	buckets(),
+	count(0),
+	totalNsecs(0),
+	maxNsecs(0)
 {}
 
-bool QHotkey::NativeShortcut::isValid() const
+void QHotkeyStats::Histogram::record(qint64 nsecs)
 {
-	return valid;
+	const quint64 duration = nsecs > 0 ? static_cast<quint64>(nsecs) : 0;
+	int bucket = 0;
+	for(quint64 usecs = duration / 1000; usecs != 0 && bucket < BucketCount - 1; usecs >>= 1)
+		++bucket;
+
+	++buckets[bucket];
+	++count;
+	totalNsecs += duration;
+	maxNsecs = qMax(maxNsecs, duration);
 }
 
-bool QHotkey::NativeShortcut::operator ==(QHotkey::NativeShortcut other) const
+QJsonObject QHotkeyStats::Histogram::toJson() const
 {
-	return (key == other.key) &&
-		   (modifier == other.modifier) &&
-		   valid == other.valid;
+	QJsonArray bucketArray;
+	for(quint64 bucket : buckets)
+		bucketArray.append(static_cast<double>(bucket));
+	return {
+		{QStringLiteral("count"), static_cast<double>(count)},
+		{QStringLiteral("totalNsecs"), static_cast<double>(totalNsecs)},
+		{QStringLiteral("maxNsecs"), static_cast<double>(maxNsecs)},
+		{QStringLiteral("buckets"), bucketArray}
+	};
 }
 
-bool QHotkey::NativeShortcut::operator !=(QHotkey::NativeShortcut other) const
+QJsonObject QHotkeyStats::Snapshot::toJson() const
 {
-	return (key != other.key) ||
-		   (modifier != other.modifier) ||
-		   valid != other.valid;
+	QJsonArray shortcutArray;
+	for(auto it = shortcuts.constBegin(); it != shortcuts.constEnd(); ++it) {
+		shortcutArray.append(QJsonObject {
+			{QStringLiteral("key"), static_cast<double>(it.key().key)},
+			{QStringLiteral("modifier"), static_cast<double>(it.key().modifier)},
+			{QStringLiteral("activations"), static_cast<double>(it->activations)},
+			{QStringLiteral("releases"), static_cast<double>(it->releases)},
+			{QStringLiteral("deliveryLatency"), it->deliveryLatency.toJson()}
+		});
+	}
+	return {
+		{QStringLiteral("registrations"), static_cast<double>(registrations)},
+		{QStringLiteral("registrationFailures"), static_cast<double>(registrationFailures)},
+		{QStringLiteral("unregistrationFailures"), static_cast<double>(unregistrationFailures)},
+		{QStringLiteral("registrationDuration"), registrationDuration.toJson()},
+		{QStringLiteral("shortcuts"), shortcutArray}
+	};
 }
 
 QHOTKEY_HASH_SEED qHash(QHotkey::NativeShortcut key)
 {
-	return qHash(key.key) ^ qHash(key.modifier);
+	return qHash(key, 0);
 }
 
 QHOTKEY_HASH_SEED qHash(QHotkey::NativeShortcut key, QHOTKEY_HASH_SEED seed)
 {
-	return qHash(key.key, seed) ^ qHash(key.modifier, seed);
+	// mixing the packed value keeps swapped key/modifier pairs and dense keycodes apart
+	return static_cast<QHOTKEY_HASH_SEED>(mixShortcut(key.packed() ^ seed));
 }
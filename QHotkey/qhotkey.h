@@ -3,8 +3,15 @@
 
 #include <QObject>
 #include <QKeySequence>
+#include <QFuture>
 #include <QPair>
+#include <QStringList>
+#include <QVector>
+#include <QHash>
+#include <QJsonObject>
 #include <QLoggingCategory>
+#include <qwindowdefs.h>
+#include <atomic>
 
 #ifdef QHOTKEY_SHARED
 #	ifdef QHOTKEY_LIBRARY
@@ -22,6 +29,8 @@
 	#define QHOTKEY_HASH_SEED uint
 #endif
 
+class QHotkeyEvent;
+
 //! A class to define global, systemwide Hotkeys
 class QHOTKEY_EXPORT QHotkey : public QObject
 {
@@ -33,8 +42,50 @@ class QHOTKEY_EXPORT QHotkey : public QObject
 	Q_PROPERTY(bool registered READ isRegistered WRITE setRegistered NOTIFY registeredChanged)
 	//! Holds the shortcut this hotkey will be triggered on
 	Q_PROPERTY(QKeySequence shortcut READ shortcut WRITE setShortcut RESET resetShortcut)
+	//! Specifies how the activated() and released() signals are delivered
+	Q_PROPERTY(DeliveryMode deliveryMode READ deliveryMode WRITE setDeliveryMode)
+	//! Specifies what happens while the shortcut is held down and the keyboard repeats it
+	Q_PROPERTY(RepeatPolicy repeatPolicy READ repeatPolicy WRITE setRepeatPolicy)
+	//! Holds the minimum time between two signals caused by repeats, in milliseconds
+	Q_PROPERTY(int repeatInterval READ repeatInterval WRITE setRepeatInterval)
+	//! Holds how long the shortcut must be held down before the hotkey is activated, in milliseconds
+	Q_PROPERTY(int holdThreshold READ holdThreshold WRITE setHoldThreshold)
+	//! Specifies where the hotkey is active
+	Q_PROPERTY(Scope scope READ scope)
 
 public:
+	//! Defines how the signals of a hotkey are delivered
+	enum DeliveryMode {
+		QueuedDelivery, //!< The signals are queued to the thread of the hotkey (default)
+		DirectDelivery //!< The signals are emitted directly from the native event handler
+	};
+	Q_ENUM(DeliveryMode)
+
+	//! Defines how keyboard repeats of a held shortcut are handled
+	enum RepeatPolicy {
+		IgnoreRepeats, //!< activated() is only emitted once per press (default)
+		CoalesceRepeats, //!< activated() is emitted again for repeats, at most once per repeatInterval
+		CountRepeats //!< repeated() is emitted with the number of repeats so far, at most once per repeatInterval
+	};
+	Q_ENUM(RepeatPolicy)
+
+	//! Describes whether a shortcut can be registered, as reported by probe()
+	enum Availability {
+		Available, //!< The shortcut is free and can be registered
+		InUse, //!< The shortcut is already registered by a hotkey of this application
+		Taken, //!< The shortcut is grabbed by an other application or reserved by the system
+		Unsupported //!< The shortcut cannot be translated to a native shortcut
+	};
+	Q_ENUM(Availability)
+
+	//! Defines where a hotkey is active
+	enum Scope {
+		GlobalScope, //!< The hotkey is active system wide (default)
+		WindowScope, //!< The hotkey is only active while the scope window or one of its children has the keyboard focus
+		ActiveWindowScope //!< The hotkey is only active while the focus window of this application has the keyboard focus
+	};
+	Q_ENUM(Scope)
+
 	//! Defines shortcut with native keycodes
 	class QHOTKEY_EXPORT NativeShortcut {
 	public:
@@ -44,20 +95,38 @@ public:
 		quint32 modifier;
 
 		//! Creates an invalid native shortcut
-		NativeShortcut();
+		constexpr NativeShortcut() :
+			key(~0u),
+			modifier(~0u)
+		{}
 		//! Creates a valid native shortcut, with the given key and modifiers
-		NativeShortcut(quint32 key, quint32 modifier = 0);
+		constexpr NativeShortcut(quint32 key, quint32 modifier = 0) :
+			key(key),
+			modifier(modifier)
+		{}
+
+		//! Creates a native shortcut from a value returned by packed()
+		static constexpr NativeShortcut fromPacked(quint64 packed) {
+			return NativeShortcut(static_cast<quint32>(packed >> 32), static_cast<quint32>(packed));
+		}
+		//! Returns key and modifiers as one value, with the key in the upper 32 bits
+		constexpr quint64 packed() const {
+			return (static_cast<quint64>(key) << 32) | modifier;
+		}
 
 		//! Checks, whether this shortcut is valid or not
-		bool isValid() const;
+		constexpr bool isValid() const {
+			return packed() != ~Q_UINT64_C(0);
+		}
 
 		//! Equality operator
-		bool operator ==(NativeShortcut other) const;
+		constexpr bool operator ==(NativeShortcut other) const {
+			return packed() == other.packed();
+		}
 		//! Inequality operator
-		bool operator !=(NativeShortcut other) const;
-
-	private:
-		bool valid;
+		constexpr bool operator !=(NativeShortcut other) const {
+			return packed() != other.packed();
+		}
 	};
 
 	//! Adds a global mapping of a key sequence to a replacement native shortcut
@@ -66,6 +135,43 @@ public:
 	//! Checks if global shortcuts are supported by the current platform
 	static bool isPlatformSupported();
 
+	//! Selects the backend to use by its name. Must be called before the first hotkey is created
+	static bool setBackend(const QString &name);
+	//! Returns the name of the backend that is (or will be) used
+	static QString backend();
+	//! Returns the names of all backends compiled into the library
+	static QStringList availableBackends();
+
+	//! Registers all the given hotkeys at once and returns the ones that could not be registered
+	static QList<QHotkey*> registerAll(const QList<QHotkey*> &hotkeys);
+	//! Unregisters all the given hotkeys at once and returns the ones that could not be unregistered
+	static QList<QHotkey*> unregisterAll(const QList<QHotkey*> &hotkeys);
+
+	//! Checks for all given shortcuts at once whether they could be registered, without keeping them registered
+	static QList<Availability> probe(const QList<QKeySequence> &shortcuts);
+	//! Returns all registered hotkeys that use the given shortcut
+	static QList<QHotkey*> hotkeysFor(const QKeySequence &shortcut);
+	//! Returns all registered hotkeys that use the given native shortcut
+	static QList<QHotkey*> hotkeysForNative(NativeShortcut nativeShortcut);
+
+	//! Moves the handling of hotkey events to a dedicated thread, if supported by the platform
+	static bool setBackendThreadMode(bool enabled);
+	//! Checks whether hotkey events are handled on a dedicated thread
+	static bool backendThreadMode();
+
+	//! Sets the file to share the key translations of the current keyboard layout with other processes
+	static void setKeyCacheFile(const QString &path);
+
+	//! Sets how long unused keys stay grabbed, so registering them again is free. 0 releases them immediately
+	static void setUngrabDelay(int msecs);
+	//! Returns how long unused keys stay grabbed, in milliseconds
+	static int ungrabDelay();
+
+	//! Sets how long a key sequence waits for its next key, in milliseconds
+	static void setChordTimeout(int msecs);
+	//! Returns how long a key sequence waits for its next key, in milliseconds
+	static int chordTimeout();
+
 	//! Default Constructor
 	explicit QHotkey(QObject *parent = nullptr);
 	//! Constructs a hotkey with a shortcut and optionally registers it
@@ -87,6 +193,23 @@ public:
 
 	//! Get the current native shortcut
 	NativeShortcut currentNativeShortcut() const;
+	//! @readAcFn{QHotkey::deliveryMode}
+	DeliveryMode deliveryMode() const;
+	//! @readAcFn{QHotkey::repeatPolicy}
+	RepeatPolicy repeatPolicy() const;
+	//! @readAcFn{QHotkey::repeatInterval}
+	int repeatInterval() const;
+	//! @readAcFn{QHotkey::holdThreshold}
+	int holdThreshold() const;
+	//! @readAcFn{QHotkey::scope}
+	Scope scope() const;
+	//! Returns the native window of a QHotkey::WindowScope hotkey
+	WId scopeWindow() const;
+
+	//! Registers the hotkey without blocking the calling thread
+	QFuture<bool> registerAsync();
+	//! Unregisters the hotkey without blocking the calling thread
+	QFuture<bool> unregisterAsync();
 
 public Q_SLOTS:
 	//! @writeAcFn{QHotkey::registered}
@@ -102,22 +225,171 @@ public Q_SLOTS:
 	//! Set this hotkey to a native shortcut
 	bool setNativeShortcut(QHotkey::NativeShortcut nativeShortcut, bool autoRegister = false);
 
+	//! @writeAcFn{QHotkey::deliveryMode}
+	void setDeliveryMode(QHotkey::DeliveryMode deliveryMode);
+	//! @writeAcFn{QHotkey::repeatPolicy}
+	void setRepeatPolicy(QHotkey::RepeatPolicy repeatPolicy);
+	//! @writeAcFn{QHotkey::repeatInterval}
+	void setRepeatInterval(int repeatInterval);
+	//! @writeAcFn{QHotkey::holdThreshold}
+	void setHoldThreshold(int holdThreshold);
+	//! @writeAcFn{QHotkey::scope}
+	bool setScope(QHotkey::Scope scope, WId window = 0, bool autoRegister = false);
+
 Q_SIGNALS:
 	//! Will be emitted if the shortcut is pressed
 	void activated(QPrivateSignal);
 
+	//! Will be emitted together with activated(), carrying the details of the key event
+	void activatedEvent(const QHotkeyEvent &event, QPrivateSignal);
 	//! Will be emitted if the shortcut press is released
 	void released(QPrivateSignal);
 
+	//! Will be emitted while the shortcut is held down, if the repeatPolicy is QHotkey::CountRepeats
+	void repeated(int repeatCount, QPrivateSignal);
+
 	//! @notifyAcFn{QHotkey::registered}
 	void registeredChanged(bool registered);
 
 private:
+	bool applyShortcut(Qt::Key keyCode, Qt::KeyboardModifiers modifiers, const QVector<int> &chordKeys, bool autoRegister);
+
 	Qt::Key _keyCode;
 	Qt::KeyboardModifiers _modifiers;
+	// the keys after the first one of a multi key sequence
+	QVector<int> _chordKeys;
 
 	NativeShortcut _nativeShortcut;
+	QVector<NativeShortcut> _chordShortcuts;
 	bool _registered;
+	DeliveryMode _deliveryMode;
+	RepeatPolicy _repeatPolicy;
+	int _repeatInterval;
+	// written by every thread that dispatches key events, several of them may do so at the same time
+	std::atomic<qint64> _lastActivationNsecs;
+	std::atomic<int> _repeatCount;
+	// set once the hotkey was in a dispatch table, which dispatching threads may still use after its removal
+	bool _dispatched;
+	// set once a registerAsync() or unregisterAsync() call was queued for the hotkey
+	bool _asyncQueued;
+	int _holdThreshold;
+	// only touched by the thread of QHotkeyPrivate
+	quint64 _holdGeneration;
+	bool _holdFired;
+	Scope _scope;
+	WId _scopeWindow;
+};
+
+//! Optional runtime statistics about hotkey activations and registrations
+class QHOTKEY_EXPORT QHotkeyStats
+{
+public:
+	//! A histogram of durations, using power of two microsecond buckets
+	class QHOTKEY_EXPORT Histogram {
+	public:
+		//! The number of buckets
+		static const int BucketCount = 32;
+
+		//! The number of durations per bucket. Bucket 0 holds durations below 1 µs, bucket n those below 2^n µs
+		quint64 buckets[BucketCount];
+		//! The number of recorded durations
+		quint64 count;
+		//! The sum of all recorded durations, in nanoseconds
+		quint64 totalNsecs;
+		//! The longest recorded duration, in nanoseconds
+		quint64 maxNsecs;
+
+		//! Creates an empty histogram
+		Histogram();
+
+		//! Adds a duration to the histogram
+		void record(qint64 nsecs);
+		//! Returns the histogram as JSON object
+		QJsonObject toJson() const;
+	};
+
+	//! The statistics of a single native shortcut
+	class QHOTKEY_EXPORT ShortcutStats {
+	public:
+		//! How often the shortcut was pressed
+		quint64 activations = 0;
+		//! How often the shortcut was released
+		quint64 releases = 0;
+		//! Time from entering the native event handler to emitting the signal of each hotkey
+		Histogram deliveryLatency;
+	};
+
+	//! A copy of all statistics at one point in time
+	class QHOTKEY_EXPORT Snapshot {
+	public:
+		//! The statistics of every native shortcut that was pressed or released
+		QHash<QHotkey::NativeShortcut, ShortcutStats> shortcuts;
+		//! Time spent on registering shortcuts with the operating system
+		Histogram registrationDuration;
+		//! The number of shortcuts registered with the operating system
+		quint64 registrations = 0;
+		//! The number of shortcuts the operating system refused to register
+		quint64 registrationFailures = 0;
+		//! The number of shortcuts the operating system refused to unregister
+		quint64 unregistrationFailures = 0;
+
+		//! Returns the snapshot as JSON object
+		QJsonObject toJson() const;
+	};
+
+	//! Enables or disables collecting statistics
+	static void setEnabled(bool enabled);
+	//! Checks whether statistics are collected
+	static bool isEnabled();
+	//! Returns a copy of the statistics collected so far
+	static Snapshot snapshot();
+	//! Clears all statistics collected so far
+	static void reset();
+};
+
+//! The details of a single key event that activated a hotkey
+class QHOTKEY_EXPORT QHotkeyEvent
+{
+public:
+	//! Creates an empty event
+	QHotkeyEvent();
+	//! Creates an event for the given shortcut, received now, without any native details
+	explicit QHotkeyEvent(QHotkey::NativeShortcut shortcut, bool repeat = false);
+	//! Creates an event with all native details
+	QHotkeyEvent(QHotkey::NativeShortcut shortcut,
+				 quint32 nativeKeycode,
+				 quint32 nativeState,
+				 quint64 timestamp,
+				 qint64 receiveNsecs,
+				 bool repeat,
+				 WId window = 0);
+
+	//! Returns the native shortcut the event was matched with
+	QHotkey::NativeShortcut nativeShortcut() const;
+	//! Returns the unfiltered native keycode of the event
+	quint32 nativeKeycode() const;
+	//! Returns the unfiltered native modifier state of the event, including locks and mouse buttons
+	quint32 nativeState() const;
+	//! Returns the timestamp the native event was sent with, in milliseconds, or 0 if the platform has none
+	quint64 timestamp() const;
+	//! Returns when the event was received, in nanoseconds on the monotonic clock
+	qint64 receiveNsecs() const;
+	//! Checks whether the event is a keyboard repeat of a held shortcut
+	bool isRepeat() const;
+	//! Returns the native window the shortcut was grabbed on, or 0 for global hotkeys
+	WId window() const;
+
+	//! Returns the current time on the clock used by receiveNsecs(), in nanoseconds
+	static qint64 currentNsecs();
+
+private:
+	QHotkey::NativeShortcut _shortcut;
+	quint32 _nativeKeycode;
+	quint32 _nativeState;
+	quint64 _timestamp;
+	qint64 _receiveNsecs;
+	bool _repeat;
+	WId _window;
 };
 
 QHOTKEY_HASH_SEED QHOTKEY_EXPORT qHash(QHotkey::NativeShortcut key);
@@ -126,5 +398,6 @@ QHOTKEY_HASH_SEED QHOTKEY_EXPORT qHash(QHotkey::NativeShortcut key, QHOTKEY_HASH
 QHOTKEY_EXPORT Q_DECLARE_LOGGING_CATEGORY(logQHotkey)
 
 Q_DECLARE_METATYPE(QHotkey::NativeShortcut)
+Q_DECLARE_METATYPE(QHotkeyEvent)
 
 #endif // QHOTKEY_H
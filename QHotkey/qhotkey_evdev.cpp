@@ -0,0 +1,531 @@
+#include "qhotkey.h"
+#include "qhotkey_p.h"
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QSet>
+#include <QThread>
+#include <linux/input.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/ioctl.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <array>
+#include <bitset>
+#include <cerrno>
+#include <cstring>
+
+// Reads the keyboards from /dev/input/event* directly, for sessions without a display server.
+// The native keys are the KEY_* codes of linux/input-event-codes.h, which describe the physical key
+// position of an US layout. Evdev cannot grab single keys, so the keys still reach other applications.
+class QHotkeyPrivateEvdev : public QHotkeyPrivate
+{
+public:
+	QHotkeyPrivateEvdev();
+	~QHotkeyPrivateEvdev() override;
+	static bool isBackendSupported();
+
+	// QAbstractNativeEventFilter interface
+	bool nativeEventFilter(const QByteArray &eventType, void *message, _NATIVE_EVENT_RESULT *result) override;
+
+protected:
+	// QHotkeyPrivate interface
+	quint32 nativeKeycode(Qt::Key keycode, bool &ok) Q_DECL_OVERRIDE;
+	quint32 nativeModifiers(Qt::KeyboardModifiers modifiers, bool &ok) Q_DECL_OVERRIDE;
+	bool registerShortcut(QHotkey::NativeShortcut shortcut) Q_DECL_OVERRIDE;
+	bool unregisterShortcut(QHotkey::NativeShortcut shortcut) Q_DECL_OVERRIDE;
+	bool setListenerThread(bool enabled) Q_DECL_OVERRIDE;
+
+private:
+	enum ModifierMask : quint32 {
+		ShiftMask = 0x01,
+		ControlMask = 0x02,
+		AltMask = 0x04,
+		MetaMask = 0x08
+	};
+
+	// waits for the events of all keyboards via epoll, an eventfd wakes it up to stop. Keyboards that are plugged in
+	// later are reported by inotify on /dev/input
+	class ListenerThread : public QThread
+	{
+	public:
+		explicit ListenerThread(QHotkeyPrivateEvdev *hotkeyPrivate);
+		~ListenerThread() override;
+
+		bool open(QString &error);
+		void stop();
+
+	protected:
+		void run() override;
+
+	private:
+		QHotkeyPrivateEvdev *hotkeyPrivate;
+		int epollFd;
+		int wakeFd;
+		int inotifyFd;
+		QHash<QByteArray, int> deviceFds;//by their path
+		std::bitset<KEY_CNT> pressedModifiers;
+		// the shortcut of each pressed key, invalid while it is up
+		std::array<QHotkey::NativeShortcut, KEY_CNT> activeKeys;
+
+		bool openDevice(const QByteArray &path);
+		void closeDevice(int fd);
+		void readHotplug();
+		void handleEvent(const input_event &event);
+		static QHotkeyEvent hotkeyEvent(const input_event &event, QHotkey::NativeShortcut shortcut);
+	};
+
+	ListenerThread *listener;
+	QSet<QHotkey::NativeShortcut> grabs;
+
+	static QStringList keyboardDevices();
+	static bool isKeyboard(int fd);
+	static quint32 modifierMask(quint16 code);
+};
+NATIVE_BACKEND(QHotkeyPrivateEvdev, Evdev)
+
+bool QHotkeyPrivateEvdev::isBackendSupported()
+{
+	// the scan opens and queries every event device, so it is only done once. The listener finds later keyboards itself
+	static const bool hasKeyboards = !keyboardDevices().isEmpty();
+	return hasKeyboards;
+}
+
+QHotkeyPrivateEvdev::QHotkeyPrivateEvdev() :
+	listener(nullptr)
+{}
+
+QHotkeyPrivateEvdev::~QHotkeyPrivateEvdev()
+{
+	if(listener) {
+		listener->stop();
+		delete listener;
+	}
+}
+
+bool QHotkeyPrivateEvdev::nativeEventFilter(const QByteArray &eventType, void *message, _NATIVE_EVENT_RESULT *result)
+{
+	Q_UNUSED(eventType)
+	Q_UNUSED(message)
+	Q_UNUSED(result)
+	return false;
+}
+
+quint32 QHotkeyPrivateEvdev::nativeKeycode(Qt::Key keycode, bool &ok)
+{
+	static const struct {
+		Qt::Key key;
+		quint16 code;
+	} keyTable[] = {
+		{Qt::Key_A, KEY_A}, {Qt::Key_B, KEY_B}, {Qt::Key_C, KEY_C}, {Qt::Key_D, KEY_D},
+		{Qt::Key_E, KEY_E}, {Qt::Key_F, KEY_F}, {Qt::Key_G, KEY_G}, {Qt::Key_H, KEY_H},
+		{Qt::Key_I, KEY_I}, {Qt::Key_J, KEY_J}, {Qt::Key_K, KEY_K}, {Qt::Key_L, KEY_L},
+		{Qt::Key_M, KEY_M}, {Qt::Key_N, KEY_N}, {Qt::Key_O, KEY_O}, {Qt::Key_P, KEY_P},
+		{Qt::Key_Q, KEY_Q}, {Qt::Key_R, KEY_R}, {Qt::Key_S, KEY_S}, {Qt::Key_T, KEY_T},
+		{Qt::Key_U, KEY_U}, {Qt::Key_V, KEY_V}, {Qt::Key_W, KEY_W}, {Qt::Key_X, KEY_X},
+		{Qt::Key_Y, KEY_Y}, {Qt::Key_Z, KEY_Z},
+		{Qt::Key_0, KEY_0}, {Qt::Key_1, KEY_1}, {Qt::Key_2, KEY_2}, {Qt::Key_3, KEY_3},
+		{Qt::Key_4, KEY_4}, {Qt::Key_5, KEY_5}, {Qt::Key_6, KEY_6}, {Qt::Key_7, KEY_7},
+		{Qt::Key_8, KEY_8}, {Qt::Key_9, KEY_9},
+		{Qt::Key_F1, KEY_F1}, {Qt::Key_F2, KEY_F2}, {Qt::Key_F3, KEY_F3}, {Qt::Key_F4, KEY_F4},
+		{Qt::Key_F5, KEY_F5}, {Qt::Key_F6, KEY_F6}, {Qt::Key_F7, KEY_F7}, {Qt::Key_F8, KEY_F8},
+		{Qt::Key_F9, KEY_F9}, {Qt::Key_F10, KEY_F10}, {Qt::Key_F11, KEY_F11}, {Qt::Key_F12, KEY_F12},
+		{Qt::Key_F13, KEY_F13}, {Qt::Key_F14, KEY_F14}, {Qt::Key_F15, KEY_F15}, {Qt::Key_F16, KEY_F16},
+		{Qt::Key_F17, KEY_F17}, {Qt::Key_F18, KEY_F18}, {Qt::Key_F19, KEY_F19}, {Qt::Key_F20, KEY_F20},
+		{Qt::Key_F21, KEY_F21}, {Qt::Key_F22, KEY_F22}, {Qt::Key_F23, KEY_F23}, {Qt::Key_F24, KEY_F24},
+		{Qt::Key_Escape, KEY_ESC},
+		{Qt::Key_Tab, KEY_TAB},
+		{Qt::Key_Backspace, KEY_BACKSPACE},
+		{Qt::Key_Return, KEY_ENTER},
+		{Qt::Key_Enter, KEY_KPENTER},
+		{Qt::Key_Insert, KEY_INSERT},
+		{Qt::Key_Delete, KEY_DELETE},
+		{Qt::Key_Pause, KEY_PAUSE},
+		{Qt::Key_Print, KEY_SYSRQ},
+		{Qt::Key_Home, KEY_HOME},
+		{Qt::Key_End, KEY_END},
+		{Qt::Key_Left, KEY_LEFT},
+		{Qt::Key_Up, KEY_UP},
+		{Qt::Key_Right, KEY_RIGHT},
+		{Qt::Key_Down, KEY_DOWN},
+		{Qt::Key_PageUp, KEY_PAGEUP},
+		{Qt::Key_PageDown, KEY_PAGEDOWN},
+		{Qt::Key_CapsLock, KEY_CAPSLOCK},
+		{Qt::Key_NumLock, KEY_NUMLOCK},
+		{Qt::Key_ScrollLock, KEY_SCROLLLOCK},
+		{Qt::Key_Menu, KEY_COMPOSE},
+		{Qt::Key_Space, KEY_SPACE},
+		{Qt::Key_Minus, KEY_MINUS},
+		{Qt::Key_Equal, KEY_EQUAL},
+		{Qt::Key_BracketLeft, KEY_LEFTBRACE},
+		{Qt::Key_BracketRight, KEY_RIGHTBRACE},
+		{Qt::Key_Backslash, KEY_BACKSLASH},
+		{Qt::Key_Semicolon, KEY_SEMICOLON},
+		{Qt::Key_Apostrophe, KEY_APOSTROPHE},
+		{Qt::Key_QuoteLeft, KEY_GRAVE},
+		{Qt::Key_Comma, KEY_COMMA},
+		{Qt::Key_Period, KEY_DOT},
+		{Qt::Key_Slash, KEY_SLASH},
+		{Qt::Key_Asterisk, KEY_KPASTERISK},
+		{Qt::Key_Plus, KEY_KPPLUS},
+		{Qt::Key_VolumeDown, KEY_VOLUMEDOWN},
+		{Qt::Key_VolumeUp, KEY_VOLUMEUP},
+		{Qt::Key_VolumeMute, KEY_MUTE},
+		{Qt::Key_MediaPlay, KEY_PLAYPAUSE},
+		{Qt::Key_MediaTogglePlayPause, KEY_PLAYPAUSE},
+		{Qt::Key_MediaStop, KEY_STOPCD},
+		{Qt::Key_MediaPrevious, KEY_PREVIOUSSONG},
+		{Qt::Key_MediaNext, KEY_NEXTSONG},
+		{Qt::Key_HomePage, KEY_HOMEPAGE},
+		{Qt::Key_Search, KEY_SEARCH},
+		{Qt::Key_Calculator, KEY_CALC},
+		{Qt::Key_LaunchMail, KEY_MAIL},
+		{Qt::Key_Sleep, KEY_SLEEP},
+		{Qt::Key_PowerOff, KEY_POWER},
+		// the left keys, the right ones can be used with a native shortcut
+		{Qt::Key_Shift, KEY_LEFTSHIFT},
+		{Qt::Key_Control, KEY_LEFTCTRL},
+		{Qt::Key_Alt, KEY_LEFTALT},
+		{Qt::Key_Meta, KEY_LEFTMETA},
+		{Qt::Key_Super_L, KEY_LEFTMETA},
+		{Qt::Key_Super_R, KEY_RIGHTMETA},
+		{Qt::Key_AltGr, KEY_RIGHTALT}
+	};
+
+	for(const auto &entry : keyTable) {
+		if(entry.key == keycode) {
+			ok = true;
+			return entry.code;
+		}
+	}
+	ok = false;
+	return 0;
+}
+
+quint32 QHotkeyPrivateEvdev::nativeModifiers(Qt::KeyboardModifiers modifiers, bool &ok)
+{
+	quint32 nMods = 0;
+	if (modifiers & Qt::ShiftModifier)
+		nMods |= ShiftMask;
+	if (modifiers & Qt::ControlModifier)
+		nMods |= ControlMask;
+	if (modifiers & Qt::AltModifier)
+		nMods |= AltMask;
+	if (modifiers & Qt::MetaModifier)
+		nMods |= MetaMask;
+	ok = true;
+	return nMods;
+}
+
+bool QHotkeyPrivateEvdev::registerShortcut(QHotkey::NativeShortcut shortcut)
+{
+	// the listener is started with the first hotkey, events of unknown shortcuts are dropped by the dispatch table
+	if(!listener) {
+		auto thread = new ListenerThread(this);
+		if(!thread->open(error)) {
+			delete thread;
+			return false;
+		}
+		listener = thread;
+		listener->start();
+	}
+
+	grabs.insert(shortcut);
+	return true;
+}
+
+bool QHotkeyPrivateEvdev::unregisterShortcut(QHotkey::NativeShortcut shortcut)
+{
+	if(!grabs.remove(shortcut)) {
+		error = QStringLiteral("The shortcut is not registered");
+		return false;
+	}
+
+	// the listener never waits for this thread, so it can be stopped while holding the registry lock
+	if(grabs.isEmpty() && listener) {
+		listener->stop();
+		delete listener;
+		listener = nullptr;
+	}
+	return true;
+}
+
+bool QHotkeyPrivateEvdev::setListenerThread(bool enabled)
+{
+	// the events are always read on the listener thread
+	Q_UNUSED(enabled)
+	return true;
+}
+
+QStringList QHotkeyPrivateEvdev::keyboardDevices()
+{
+	QStringList devices;
+	const QDir inputDir(QStringLiteral("/dev/input"));
+	for(const QString &name : inputDir.entryList({QStringLiteral("event*")}, QDir::System)) {
+		const QString path = inputDir.absoluteFilePath(name);
+		const int fd = ::open(QFile::encodeName(path).constData(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+		if(fd < 0)
+			continue;
+		if(isKeyboard(fd))
+			devices.append(path);
+		::close(fd);
+	}
+	return devices;
+}
+
+bool QHotkeyPrivateEvdev::isKeyboard(int fd)
+{
+	unsigned long eventBits = 0;
+	if(ioctl(fd, EVIOCGBIT(0, sizeof(eventBits)), &eventBits) < 0 ||
+	   !(eventBits & (1UL << EV_KEY)))
+		return false;
+
+	// mice and buttons report EV_KEY too, so require some letters
+	unsigned char keyBits[KEY_MAX / 8 + 1];
+	std::memset(keyBits, 0, sizeof(keyBits));
+	if(ioctl(fd, EVIOCGBIT(EV_KEY, sizeof(keyBits)), keyBits) < 0)
+		return false;
+	for(int code : {KEY_A, KEY_Z, KEY_SPACE}) {
+		if(!(keyBits[code / 8] & (1 << (code % 8))))
+			return false;
+	}
+	return true;
+}
+
+quint32 QHotkeyPrivateEvdev::modifierMask(quint16 code)
+{
+	switch (code) {
+	case KEY_LEFTSHIFT:
+	case KEY_RIGHTSHIFT:
+		return ShiftMask;
+	case KEY_LEFTCTRL:
+	case KEY_RIGHTCTRL:
+		return ControlMask;
+	case KEY_LEFTALT:
+	case KEY_RIGHTALT:
+		return AltMask;
+	case KEY_LEFTMETA:
+	case KEY_RIGHTMETA:
+		return MetaMask;
+	default:
+		return 0;
+	}
+}
+
+
+
+QHotkeyPrivateEvdev::ListenerThread::ListenerThread(QHotkeyPrivateEvdev *hotkeyPrivate) :
+	QThread(),
+	hotkeyPrivate(hotkeyPrivate),
+	epollFd(-1),
+	wakeFd(-1),
+	inotifyFd(-1)
+{
+	setObjectName(QStringLiteral("QHotkeyEvdevListener"));
+}
+
+QHotkeyPrivateEvdev::ListenerThread::~ListenerThread()
+{
+	for(int fd : deviceFds)
+		::close(fd);
+	if(inotifyFd >= 0)
+		::close(inotifyFd);
+	if(wakeFd >= 0)
+		::close(wakeFd);
+	if(epollFd >= 0)
+		::close(epollFd);
+}
+
+bool QHotkeyPrivateEvdev::ListenerThread::open(QString &error)
+{
+	epollFd = epoll_create1(EPOLL_CLOEXEC);
+	wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if(epollFd < 0 || wakeFd < 0) {
+		error = QString::fromLocal8Bit(std::strerror(errno));
+		return false;
+	}
+
+	epoll_event event;
+	std::memset(&event, 0, sizeof(event));
+	event.events = EPOLLIN;
+	event.data.fd = wakeFd;
+	if(epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &event) < 0) {
+		error = QString::fromLocal8Bit(std::strerror(errno));
+		return false;
+	}
+
+	// watched before the devices are opened, so none can be missed in between. Udev creates the nodes first and
+	// grants the access afterwards, which is reported as attribute change
+	inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	event.data.fd = inotifyFd;
+	if(inotifyFd < 0 ||
+	   inotify_add_watch(inotifyFd, "/dev/input", IN_CREATE | IN_ATTRIB) < 0 ||
+	   epoll_ctl(epollFd, EPOLL_CTL_ADD, inotifyFd, &event) < 0)
+		qCWarning(logQHotkey) << "Keyboards plugged in later are ignored, watching /dev/input failed:" << std::strerror(errno);
+
+	const QDir inputDir(QStringLiteral("/dev/input"));
+	for(const QString &name : inputDir.entryList({QStringLiteral("event*")}, QDir::System))
+		openDevice(QFile::encodeName(inputDir.absoluteFilePath(name)));
+
+	if(deviceFds.isEmpty()) {
+		error = QStringLiteral("No readable keyboard found in /dev/input. The user needs read access to the event devices, "
+							   "usually via the \"input\" group");
+		return false;
+	}
+	return true;
+}
+
+void QHotkeyPrivateEvdev::ListenerThread::stop()
+{
+	const quint64 value = 1;
+	if(::write(wakeFd, &value, sizeof(value)) < 0)
+		qCWarning(logQHotkey) << "Failed to wake up the evdev listener:" << std::strerror(errno);
+	wait();
+}
+
+void QHotkeyPrivateEvdev::ListenerThread::run()
+{
+	epoll_event events[16];
+	input_event buffer[64];
+	while(true) {
+		const int count = epoll_wait(epollFd, events, 16, -1);
+		if(count < 0) {
+			if(errno == EINTR)
+				continue;
+			qCWarning(logQHotkey) << "Failed to wait for evdev events:" << std::strerror(errno);
+			return;
+		}
+
+		for(int i = 0; i < count; ++i) {
+			const int fd = events[i].data.fd;
+			if(fd == wakeFd)
+				return;
+			if(fd == inotifyFd) {
+				readHotplug();
+				continue;
+			}
+
+			const ssize_t size = ::read(fd, buffer, sizeof(buffer));
+			if(size < 0) {
+				// ENODEV means the keyboard was unplugged
+				if(errno != EAGAIN && errno != EINTR)
+					closeDevice(fd);
+				continue;
+			}
+			for(size_t j = 0; j < static_cast<size_t>(size) / sizeof(input_event); ++j)
+				handleEvent(buffer[j]);
+		}
+	}
+}
+
+bool QHotkeyPrivateEvdev::ListenerThread::openDevice(const QByteArray &path)
+{
+	if(deviceFds.contains(path))
+		return true;
+
+	const int fd = ::open(path.constData(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+	if(fd < 0)
+		return false;
+	epoll_event event;
+	std::memset(&event, 0, sizeof(event));
+	event.events = EPOLLIN;
+	event.data.fd = fd;
+	if(!isKeyboard(fd) || epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) < 0) {
+		::close(fd);
+		return false;
+	}
+	deviceFds.insert(path, fd);
+	return true;
+}
+
+void QHotkeyPrivateEvdev::ListenerThread::closeDevice(int fd)
+{
+	epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+	::close(fd);
+	for(auto it = deviceFds.begin(); it != deviceFds.end(); ++it) {
+		if(it.value() == fd) {
+			deviceFds.erase(it);
+			break;
+		}
+	}
+}
+
+void QHotkeyPrivateEvdev::ListenerThread::readHotplug()
+{
+	alignas(inotify_event) char buffer[4096];
+	while(true) {
+		const ssize_t size = ::read(inotifyFd, buffer, sizeof(buffer));
+		if(size <= 0)
+			return;
+
+		for(ssize_t pos = 0; pos < size;) {
+			const auto *event = reinterpret_cast<const inotify_event *>(buffer + pos);
+			pos += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+			// the name is padded with null bytes
+			const QByteArray name(event->len > 0 ? event->name : "");
+			if(name.startsWith("event"))
+				openDevice(QByteArrayLiteral("/dev/input/") + name);
+		}
+	}
+}
+
+void QHotkeyPrivateEvdev::ListenerThread::handleEvent(const input_event &event)
+{
+	if(event.type != EV_KEY || event.code >= KEY_CNT)
+		return;
+
+	// modifier keys are tracked for the other keys, but can be shortcuts of their own as well
+	if(modifierMask(event.code) != 0)
+		pressedModifiers.set(event.code, event.value != 0);
+
+	switch (event.value) {
+	case 1: {
+		quint32 modifiers = 0;
+		for(quint16 code : {KEY_LEFTSHIFT, KEY_RIGHTSHIFT, KEY_LEFTCTRL, KEY_RIGHTCTRL,
+							KEY_LEFTALT, KEY_RIGHTALT, KEY_LEFTMETA, KEY_RIGHTMETA}) {
+			if(code != event.code && pressedModifiers.test(code))
+				modifiers |= modifierMask(code);
+		}
+		const QHotkey::NativeShortcut shortcut(event.code, modifiers);
+		activeKeys[event.code] = shortcut;
+		hotkeyPrivate->activateShortcut(hotkeyEvent(event, shortcut));
+		break;
+	}
+	case 0: {
+		// release with the modifiers of the press, they might have been released first
+		const QHotkey::NativeShortcut shortcut = activeKeys[event.code];
+		if(shortcut.isValid()) {
+			hotkeyPrivate->releaseShortcut(shortcut);
+			activeKeys[event.code] = QHotkey::NativeShortcut();
+		}
+		break;
+	}
+	case 2: {
+		// autorepeat, reported with the modifiers of the press like the release
+		const QHotkey::NativeShortcut shortcut = activeKeys[event.code];
+		if(shortcut.isValid())
+			hotkeyPrivate->repeatShortcut(hotkeyEvent(event, shortcut));
+		break;
+	}
+	default:
+		break;
+	}
+}
+
+QHotkeyEvent QHotkeyPrivateEvdev::ListenerThread::hotkeyEvent(const input_event &event, QHotkey::NativeShortcut shortcut)
+{
+	// newer kernel headers hide the timeval behind these macros for 64 bit time on 32 bit systems
+#ifdef input_event_sec
+	const quint64 timestamp = static_cast<quint64>(event.input_event_sec) * 1000 + event.input_event_usec / 1000;
+#else
+	const quint64 timestamp = static_cast<quint64>(event.time.tv_sec) * 1000 + event.time.tv_usec / 1000;
+#endif
+	return QHotkeyEvent(shortcut,
+						event.code,
+						shortcut.modifier,
+						timestamp,
+						QHotkeyEvent::currentNsecs(),
+						event.value == 2);
+}
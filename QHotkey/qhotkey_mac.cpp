@@ -6,6 +6,8 @@
 class QHotkeyPrivateMac : public QHotkeyPrivate
 {
 public:
+	static bool isBackendSupported();
+
 	// QAbstractNativeEventFilter interface
 	bool nativeEventFilter(const QByteArray &eventType, void *message, _NATIVE_EVENT_RESULT *result) override;
 
@@ -23,9 +25,9 @@ private:
 	static bool isHotkeyHandlerRegistered;
 	static QHash<QHotkey::NativeShortcut, EventHotKeyRef> hotkeyRefs;
 };
-NATIVE_INSTANCE(QHotkeyPrivateMac)
+NATIVE_BACKEND(QHotkeyPrivateMac, Mac)
 
-bool QHotkeyPrivate::isPlatformSupported()
+bool QHotkeyPrivateMac::isBackendSupported()
 {
 	return true;
 }
@@ -263,7 +265,14 @@ OSStatus QHotkeyPrivateMac::hotkeyPressEventHandler(EventHandlerCallRef nextHand
 						  sizeof(EventHotKeyID),
 						  NULL,
 						  &hkeyID);
-		hotkeyPrivate->activateShortcut({hkeyID.signature, hkeyID.id});
+		const QHotkey::NativeShortcut shortcut(hkeyID.signature, hkeyID.id);
+		// the event time is in seconds since boot
+		hotkeyPrivate->activateShortcut(QHotkeyEvent(shortcut,
+													 shortcut.key,
+													 shortcut.modifier,
+													 static_cast<quint64>(GetEventTime(event) * 1000.0),
+													 QHotkeyEvent::currentNsecs(),
+													 false));
 	}
 
 	return noErr;
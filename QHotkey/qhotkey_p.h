@@ -3,9 +3,16 @@
 
 #include "qhotkey.h"
 #include <QAbstractNativeEventFilter>
+#include <QFile>
+#include <QMetaMethod>
 #include <QMultiHash>
 #include <QMutex>
+#include <QReadWriteLock>
 #include <QGlobalStatic>
+#include <QTimer>
+#include <QVector>
+#include <atomic>
+#include <functional>
 
 #if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
 	#define _NATIVE_EVENT_RESULT qintptr
@@ -13,9 +20,12 @@
 	#define _NATIVE_EVENT_RESULT long
 #endif
 
+class QHotkeyTrace;
+
 class QHOTKEY_EXPORT QHotkeyPrivate : public QObject, public QAbstractNativeEventFilter
 {
 	Q_OBJECT
+	friend class QHotkeyTrace;
 
 public:
 	QHotkeyPrivate();//singleton!!!
@@ -24,39 +34,287 @@ public:
 	static QHotkeyPrivate *instance();
 	static bool isPlatformSupported();
 
+	static bool setBackend(const QString &name);
+	static QString backendName();
+	static QStringList availableBackends();
+
 	QHotkey::NativeShortcut nativeShortcut(Qt::Key keycode, Qt::KeyboardModifiers modifiers);
 
+	bool setThreadMode(bool enabled);
+	bool threadMode() const;
+
+	void setStatsEnabled(bool enabled);
+	bool isStatsEnabled() const;
+	QHotkeyStats::Snapshot statsSnapshot();
+	void resetStats();
+
+	void setChordTimeout(int msecs);
+	int chordTimeout() const;
+
+	void setKeyCacheFile(const QString &path);
+
+	void setUngrabDelay(int msecs);
+	int ungrabDelay() const;
+
 	bool addShortcut(QHotkey *hotkey);
+	QList<QHotkey*> addShortcuts(const QList<QHotkey*> &hotkeys);
 	bool removeShortcut(QHotkey *hotkey);
+	QList<QHotkey*> removeShortcuts(const QList<QHotkey*> &hotkeys);
+	void updateShortcut(QHotkey *hotkey);
+
+	// blocks until no other thread dispatches with a table from before this call
+	void waitForDispatchers();
+
+	QList<QHotkey::Availability> probe(const QList<QKeySequence> &sequences);
+	QList<QHotkey*> hotkeysFor(QHotkey::NativeShortcut shortcut);
+
+	QFuture<bool> addShortcutAsync(QHotkey *hotkey);
+	QFuture<bool> removeShortcutAsync(QHotkey *hotkey);
+	void cancelAsyncCalls(QHotkey *hotkey);
 
 protected:
 	void activateShortcut(QHotkey::NativeShortcut shortcut);
-	void releaseShortcut(QHotkey::NativeShortcut shortcut);
+	void activateShortcut(const QHotkeyEvent &event);//for backends that know the native details of the event
+	void releaseShortcut(QHotkey::NativeShortcut shortcut, WId window = 0);
+	void repeatShortcut(QHotkey::NativeShortcut shortcut);//for keyboard repeats while the shortcut is held
+	void repeatShortcut(const QHotkeyEvent &event);
 
 	virtual quint32 nativeKeycode(Qt::Key keycode, bool &ok) = 0;//platform implement
 	virtual quint32 nativeModifiers(Qt::KeyboardModifiers modifiers, bool &ok) = 0;//platform implement
 
 	virtual bool registerShortcut(QHotkey::NativeShortcut shortcut) = 0;//platform implement
 	virtual bool unregisterShortcut(QHotkey::NativeShortcut shortcut) = 0;//platform implement
+	virtual QList<QHotkey::NativeShortcut> registerShortcuts(const QList<QHotkey::NativeShortcut> &shortcuts);//returns the failed ones
+	virtual QList<QHotkey::NativeShortcut> unregisterShortcuts(const QList<QHotkey::NativeShortcut> &shortcuts);//returns the failed ones
+	// grabs that only apply while the window or one of its children has the focus. Unsupported by default
+	virtual QList<QHotkey::NativeShortcut> registerWindowShortcuts(const QList<QHotkey::NativeShortcut> &shortcuts, WId window);//returns the failed ones
+	virtual QList<QHotkey::NativeShortcut> unregisterWindowShortcuts(const QList<QHotkey::NativeShortcut> &shortcuts, WId window);//returns the failed ones
+
+	virtual bool setListenerThread(bool enabled);//optional platform implement
+	// whether the native calls may be made from any thread, serialized by the registryLock. Otherwise they only run on the thread of this object
+	virtual bool isThreadSafe() const;//optional platform implement
+	virtual quint64 keymapHash();//optional platform implement, 0 disables the key cache
+	// called for every registered shortcut whenever the registrations change, for platforms that drop repeats at the grab
+	virtual void setShortcutRepeats(QHotkey::NativeShortcut shortcut, bool repeats);//optional platform implement
+
+	// call with every native event before handling it. Costs a single atomic load while no QHotkeyTrace records
+	void traceEvent(const void *message, int size);
+	virtual QByteArray traceEventType() const;//optional platform implement, the type for nativeEventFilter. Empty if events cannot be traced
+	virtual void prepareReplay(QByteArray &message);//optional platform implement, adjusts a recorded event to the current session
+
+	void remapShortcuts();//call when the keyboard layout changed
+	// while a window of this application has the focus, the event filter also sees keys that were never grabbed
+	bool hasListeners(QHotkey::NativeShortcut shortcut, WId window);
 
 	QString error;
 
+	// write lock of the registrations, the translations and all native calls. It can be nested on the same
+	// thread, so slots that are called directly can register hotkeys again
+	class RegistryWriteLocker
+	{
+	public:
+		explicit RegistryWriteLocker(QHotkeyPrivate *hotkeyPrivate);
+		~RegistryWriteLocker();
+
+	private:
+		QHotkeyPrivate *hotkeyPrivate;
+
+		Q_DISABLE_COPY(RegistryWriteLocker)
+	};
+
 private:
+	// immutable, open-addressed snapshot of the shortcuts table, used by the event filters
+	struct DispatchTable {
+		struct Bucket {
+			quint64 key;
+			int first;
+			int count;
+		};
+		struct Listener {
+			QHotkey *hotkey;
+			bool direct;
+			QHotkey::RepeatPolicy repeatPolicy;
+			qint64 repeatIntervalNsecs;
+			bool hold;
+		};
+
+		QVector<Bucket> buckets;
+		QVector<Listener> listeners;
+		quint64 mask = 0;
+		mutable const DispatchTable *nextRetired = nullptr;
+
+		const Bucket *find(quint64 key) const;
+	};
+
 	QHash<QPair<Qt::Key, Qt::KeyboardModifiers>, QHotkey::NativeShortcut> mapping;
 	QMultiHash<QHotkey::NativeShortcut, QHotkey*> shortcuts;
 
+	std::atomic<bool> threadModeEnabled;
+	std::atomic<const DispatchTable*> dispatchTable;
+	std::atomic<quint64> dispatchGeneration;//changes with every rebuild
+	// readers count themselves in the slot of the current epoch. Waiting for them flips the epoch first, so readers
+	// that start afterwards can never starve the waiting thread
+	std::atomic<int> readerEpoch;
+	std::atomic<int> activeReaders[2];
+	QMutex readerWaitMutex;
+	// replaced tables wait here until the thread of this object frees them, so dispatching never takes a lock for it
+	std::atomic<const DispatchTable*> retiredTables;
+
+	void rebuildDispatchTable();
+	void reclaimDispatchTables();
+	int enterDispatch();
+	void leaveDispatch(int epoch);
+	bool isListening(QHotkey::NativeShortcut shortcut, QHotkey *hotkey, quint64 generation);
+	void dispatchSignal(QHotkey::NativeShortcut shortcut, const QMetaMethod &signal, const QHotkeyEvent *event);
+	void emitEvent(QHotkey *hotkey, const QHotkeyEvent &event, Qt::ConnectionType conType);
+
+	// only touched while statsEnabled is set
+	std::atomic<bool> statsEnabled;
+	QMutex statsMutex;
+	QHotkeyStats::Snapshot stats;
+
+	void recordRegistration(qint64 startNsecs, int count, int failures);
+	void recordUnregistrationFailure();
+	void recordDelivery(QHotkey::NativeShortcut shortcut, qint64 entryNsecs);
+
+	// prefix tree of all registered multi key sequences, only touched on the thread of this object
+	struct ChordNode {
+		QHash<QHotkey::NativeShortcut, ChordNode*> children;
+		QList<QHotkey*> hotkeys;
+
+		ChordNode() = default;
+		~ChordNode();
+		Q_DISABLE_COPY(ChordNode)
+	};
+
+	QMultiHash<QHotkey::NativeShortcut, QHotkey*> chordHotkeys;//by their first key
+	ChordNode chordRoot;
+	ChordNode *chordState;
+	QList<QHotkey::NativeShortcut> chordGrabs;//keys only grabbed while a sequence is in progress
+	QTimer chordTimer;
+	std::atomic<bool> hasChords;
+	std::atomic<int> chordTimeoutMsecs;
+
+	// optional file backed cache of the key translations, mapped into memory and shared between processes
+	QString keyCachePath;
+	QFile keyCacheFile;
+	const uchar *keyCacheData;
+	int keyCacheCount;
+	bool keyCacheLoaded;
+	quint64 keyCacheHash;
+	QHash<QPair<Qt::Key, Qt::KeyboardModifiers>, QHotkey::NativeShortcut> keyCacheAdditions;
+	QTimer keyCacheTimer;
+
+	void loadKeyCache();
+	void closeKeyCache();
+	bool findInKeyCache(Qt::Key keycode, Qt::KeyboardModifiers modifiers, QHotkey::NativeShortcut &shortcut) const;
+	void writeKeyCache();
+
+	// keys without hotkeys that stay grabbed until their deadline, in case they are registered again
+	QHash<QHotkey::NativeShortcut, qint64> pendingUngrabs;
+	QTimer ungrabTimer;
+	std::atomic<int> ungrabDelayMsecs;
+
+	QList<QHotkey::NativeShortcut> releaseGrabs(const QList<QHotkey::NativeShortcut> &shortcuts);
+	void reuseGrab(QHotkey::NativeShortcut shortcut);
+	void flushUngrabs(bool all);
+	void flushExpiredUngrabs();
+
+	// pressed hotkeys with a hold threshold, in a single timer wheel instead of one timer per hotkey
+	struct HoldEntry {
+		QHotkey *hotkey;
+		quint64 generation;
+		int rounds;
+		QHotkeyEvent event;
+	};
+	QVector<QVector<HoldEntry>> holdWheel;
+	QVector<HoldEntry> dueHolds;
+	int holdWheelPos;
+	int holdCount;
+	qint64 holdWheelNsecs;
+	QTimer holdTimer;
+
+	void processHold(QHotkey::NativeShortcut shortcut, const QHotkeyEvent *event);
+	void scheduleHold(QHotkey *hotkey, const QHotkeyEvent &event);
+	void cancelHolds(QHotkey *hotkey);
+	void advanceHoldWheel();
+
+	// scoped hotkeys are grabbed on their window and indexed per window. They are rare compared to key events of global
+	// ones, so they are dispatched on the thread of this object instead of through the dispatch table
+	QHash<WId, QMultiHash<QHotkey::NativeShortcut, QHotkey*>> windowShortcuts;
+	QMultiHash<QHotkey::NativeShortcut, QHotkey*> activeWindowShortcuts;
+	WId activeWindow;
+	std::atomic<bool> hasScoped;//lets the event filters check without the registryLock
+
+	bool addScopedShortcut(QHotkey *hotkey);
+	bool removeScopedShortcut(QHotkey *hotkey);
+	bool isWindowGrabbed(QHotkey::NativeShortcut shortcut, WId window) const;
+	bool hasScopedShortcuts() const;
+	bool isScopedEvent(QHotkey::NativeShortcut shortcut, WId window);
+	void remapScopedShortcuts(QList<QHotkey*> &lostHotkeys);
+	void dispatchScoped(const QHotkeyEvent &event, bool activation);
+	void focusWindowChanged();
+
+	// readers on other threads run in parallel, the writer is tracked because a read lock cannot be nested into a write lock
+	QReadWriteLock registryLock;
+	std::atomic<Qt::HANDLE> registryWriter;
+	int registryWriteDepth;
+
+	bool runConcurrently(const QList<QHotkey*> &hotkeys, const std::function<void()> &registration);
+
+	// the hotkeys of queued async calls, by call. Their hotkeys may be destroyed on their own thread before they run
+	QHash<quint64, QHotkey*> asyncCalls;
+	quint64 nextAsyncCall;
+
+	QFuture<bool> runAsync(QHotkey *hotkey, const std::function<bool(QHotkey*)> &call);
+	void emitRegisteredChanged(QHotkey *hotkey, bool registered);
+
+	bool isGrabbed(QHotkey::NativeShortcut shortcut) const;
+	void scheduleKeyCacheWrite();
+	void rebuildChordTree();
+	bool processChordKey(const QHotkeyEvent &event);
+	void advanceChord(ChordNode *node, const QHotkeyEvent &event);
+	void finishChord();
+
+	// the recording trace, events may be traced from the listener thread as well
+	QMutex traceMutex;
+	QHotkeyTrace *traceRecorder;
+	std::atomic<bool> tracing;
+
+	bool attachTrace(QHotkeyTrace *trace);
+	void detachTrace(QHotkeyTrace *trace);
+	bool replayEvent(const QByteArray &eventType, void *message);
+
 	Q_INVOKABLE void addMappingInvoked(Qt::Key keycode, Qt::KeyboardModifiers modifiers, QHotkey::NativeShortcut nativeShortcut);
 	Q_INVOKABLE bool addShortcutInvoked(QHotkey *hotkey);
+	Q_INVOKABLE QList<QHotkey*> addShortcutsInvoked(const QList<QHotkey*> &hotkeys);
 	Q_INVOKABLE bool removeShortcutInvoked(QHotkey *hotkey);
+	Q_INVOKABLE QList<QHotkey*> removeShortcutsInvoked(const QList<QHotkey*> &hotkeys);
+	Q_INVOKABLE void updateShortcutInvoked(QHotkey *hotkey);
+	Q_INVOKABLE bool setThreadModeInvoked(bool enabled);
+	Q_INVOKABLE void setKeyCacheFileInvoked(const QString &path);
+	Q_INVOKABLE void setUngrabDelayInvoked(int msecs);
 	Q_INVOKABLE QHotkey::NativeShortcut nativeShortcutInvoked(Qt::Key keycode, Qt::KeyboardModifiers modifiers);
+	Q_INVOKABLE QList<QHotkey::Availability> probeInvoked(const QList<QKeySequence> &sequences);
 };
 
-#define NATIVE_INSTANCE(ClassName) \
+// every backend is compiled in with a QHOTKEY_HAVE_<Name> definition and registered in qhotkey.cpp.
+// The class needs a static isBackendSupported(), it is only instantiated if selected
+#define NATIVE_BACKEND(ClassName, Name) \
 	Q_GLOBAL_STATIC(ClassName, hotkeyPrivate) \
 	\
-	QHotkeyPrivate *QHotkeyPrivate::instance()\
+	QHotkeyPrivate *qhotkey##Name##Instance()\
 	{\
 		return hotkeyPrivate;\
+	}\
+	\
+	bool qhotkeyIs##Name##Supported()\
+	{\
+		return ClassName::isBackendSupported();\
 	}
 
+#define DECLARE_NATIVE_BACKEND(Name) \
+	QHotkeyPrivate *qhotkey##Name##Instance(); \
+	bool qhotkeyIs##Name##Supported();
+
 #endif // QHOTKEY_P_H
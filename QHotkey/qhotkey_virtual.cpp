@@ -0,0 +1,272 @@
+#include "qhotkey.h"
+#include "qhotkey_virtual_p.h"
+#include <QDebug>
+#include <chrono>
+#include <cstring>
+
+NATIVE_BACKEND(QHotkeyPrivateVirtual, Virtual)
+
+bool QHotkeyPrivateVirtual::isBackendSupported()
+{
+	return true;
+}
+
+QHotkeyPrivateVirtual::QHotkeyPrivateVirtual() :
+	injector(nullptr),
+	injected(0)
+{}
+
+QHotkeyPrivateVirtual::~QHotkeyPrivateVirtual()
+{
+	stopInjection();
+}
+
+QHotkeyPrivateVirtual *QHotkeyPrivateVirtual::virtualInstance()
+{
+	// only the selected backend gets created
+	QHotkeyPrivate::instance();
+	return hotkeyPrivate.exists() ? static_cast<QHotkeyPrivateVirtual*>(hotkeyPrivate) : nullptr;
+}
+
+bool QHotkeyPrivateVirtual::nativeEventFilter(const QByteArray &eventType, void *message, _NATIVE_EVENT_RESULT *result)
+{
+	Q_UNUSED(result)
+	// only replayed traces come in here, the events of the platform are never meant for this backend
+	if(eventType == traceEventType())
+		handleMessage(*static_cast<const Message*>(message));
+	return false;
+}
+
+void QHotkeyPrivateVirtual::injectPress(QHotkey::NativeShortcut shortcut, WId window)
+{
+	handleMessage(createMessage(PressMessage, shortcut, window));
+}
+
+void QHotkeyPrivateVirtual::injectRepeat(QHotkey::NativeShortcut shortcut, WId window)
+{
+	handleMessage(createMessage(RepeatMessage, shortcut, window));
+}
+
+void QHotkeyPrivateVirtual::injectRelease(QHotkey::NativeShortcut shortcut, WId window)
+{
+	handleMessage(createMessage(ReleaseMessage, shortcut, window));
+}
+
+bool QHotkeyPrivateVirtual::startInjection(const QList<QHotkey::NativeShortcut> &shortcuts, int eventsPerSecond)
+{
+	if(injector || shortcuts.isEmpty() || eventsPerSecond < 0)
+		return false;
+
+	injector = new InjectionThread(this, shortcuts, eventsPerSecond);
+	injector->start();
+	return true;
+}
+
+void QHotkeyPrivateVirtual::stopInjection()
+{
+	if(injector) {
+		injector->stop();
+		delete injector;
+		injector = nullptr;
+	}
+}
+
+bool QHotkeyPrivateVirtual::isInjecting() const
+{
+	return injector && injector->isRunning();
+}
+
+quint64 QHotkeyPrivateVirtual::injectedEvents() const
+{
+	return injected.load(std::memory_order_relaxed);
+}
+
+bool QHotkeyPrivateVirtual::isShortcutGrabbed(QHotkey::NativeShortcut shortcut) const
+{
+	QMutexLocker locker(&grabMutex);
+	return grabs.contains(shortcut);
+}
+
+bool QHotkeyPrivateVirtual::isWindowShortcutGrabbed(QHotkey::NativeShortcut shortcut, WId window) const
+{
+	QMutexLocker locker(&grabMutex);
+	return window != 0 && windowGrabs.contains({window, shortcut});
+}
+
+int QHotkeyPrivateVirtual::grabCount() const
+{
+	QMutexLocker locker(&grabMutex);
+	return grabs.size();
+}
+
+void QHotkeyPrivateVirtual::setShortcutRejected(QHotkey::NativeShortcut shortcut, bool rejected)
+{
+	QMutexLocker locker(&grabMutex);
+	if(rejected)
+		this->rejected.insert(shortcut);
+	else
+		this->rejected.remove(shortcut);
+}
+
+quint32 QHotkeyPrivateVirtual::nativeKeycode(Qt::Key keycode, bool &ok)
+{
+	ok = keycode != Qt::Key_unknown;
+	return static_cast<quint32>(keycode);
+}
+
+quint32 QHotkeyPrivateVirtual::nativeModifiers(Qt::KeyboardModifiers modifiers, bool &ok)
+{
+	ok = true;
+	return static_cast<quint32>(modifiers);
+}
+
+bool QHotkeyPrivateVirtual::registerShortcut(QHotkey::NativeShortcut shortcut)
+{
+	QMutexLocker locker(&grabMutex);
+	if(rejected.contains(shortcut)) {
+		error = QStringLiteral("The shortcut was rejected");
+		return false;
+	}
+	if(grabs.contains(shortcut)) {
+		error = QStringLiteral("The shortcut is already grabbed");
+		return false;
+	}
+	grabs.insert(shortcut);
+	return true;
+}
+
+bool QHotkeyPrivateVirtual::unregisterShortcut(QHotkey::NativeShortcut shortcut)
+{
+	QMutexLocker locker(&grabMutex);
+	if(!grabs.remove(shortcut)) {
+		error = QStringLiteral("The shortcut is not grabbed");
+		return false;
+	}
+	return true;
+}
+
+QList<QHotkey::NativeShortcut> QHotkeyPrivateVirtual::registerWindowShortcuts(const QList<QHotkey::NativeShortcut> &shortcuts, WId window)
+{
+	QMutexLocker locker(&grabMutex);
+	QList<QHotkey::NativeShortcut> failed;
+	for(QHotkey::NativeShortcut shortcut : shortcuts) {
+		if(rejected.contains(shortcut)) {
+			error = QStringLiteral("The shortcut was rejected");
+			failed.append(shortcut);
+		} else
+			windowGrabs.insert({window, shortcut});
+	}
+	return failed;
+}
+
+QList<QHotkey::NativeShortcut> QHotkeyPrivateVirtual::unregisterWindowShortcuts(const QList<QHotkey::NativeShortcut> &shortcuts, WId window)
+{
+	QMutexLocker locker(&grabMutex);
+	QList<QHotkey::NativeShortcut> failed;
+	for(QHotkey::NativeShortcut shortcut : shortcuts) {
+		if(!windowGrabs.remove({window, shortcut})) {
+			error = QStringLiteral("The shortcut is not grabbed");
+			failed.append(shortcut);
+		}
+	}
+	return failed;
+}
+
+bool QHotkeyPrivateVirtual::setListenerThread(bool enabled)
+{
+	// injected events may come from any thread anyway
+	Q_UNUSED(enabled)
+	return true;
+}
+
+bool QHotkeyPrivateVirtual::isThreadSafe() const
+{
+	return true;
+}
+
+QByteArray QHotkeyPrivateVirtual::traceEventType() const
+{
+	return QByteArrayLiteral("qhotkey_virtual");
+}
+
+void QHotkeyPrivateVirtual::prepareReplay(QByteArray &message)
+{
+	// the windows of the recording are gone, so the events are replayed as global ones. Broken ones are ignored
+	Message replayed = createMessage(InvalidMessage, {}, 0);
+	if(message.size() == static_cast<int>(sizeof(Message))) {
+		std::memcpy(&replayed, message.constData(), sizeof(Message));
+		replayed.window = 0;
+	}
+	message = QByteArray(reinterpret_cast<const char*>(&replayed), sizeof(Message));
+}
+
+QHotkeyPrivateVirtual::Message QHotkeyPrivateVirtual::createMessage(MessageType type, QHotkey::NativeShortcut shortcut, WId window)
+{
+	static_assert(sizeof(Message) == 24, "Traced messages must not contain padding");
+	return {static_cast<quint64>(window), type, shortcut.key, shortcut.modifier, 0};
+}
+
+void QHotkeyPrivateVirtual::handleMessage(const Message &message)
+{
+	injected.fetch_add(1, std::memory_order_relaxed);
+	const QHotkey::NativeShortcut shortcut(message.key, message.modifier);
+	const WId window = static_cast<WId>(message.window);
+	if(!isShortcutGrabbed(shortcut) && !isWindowShortcutGrabbed(shortcut, window))
+		return;
+
+	traceEvent(&message, sizeof(message));
+	switch(message.type) {
+	case PressMessage:
+		activateShortcut(QHotkeyEvent(shortcut, shortcut.key, shortcut.modifier, 0, QHotkeyEvent::currentNsecs(), false, window));
+		break;
+	case RepeatMessage:
+		repeatShortcut(QHotkeyEvent(shortcut, shortcut.key, shortcut.modifier, 0, QHotkeyEvent::currentNsecs(), true, window));
+		break;
+	case ReleaseMessage:
+		releaseShortcut(shortcut, window);
+		break;
+	default:
+		break;
+	}
+}
+
+
+
+QHotkeyPrivateVirtual::InjectionThread::InjectionThread(QHotkeyPrivateVirtual *hotkeyPrivate, const QList<QHotkey::NativeShortcut> &shortcuts, int eventsPerSecond) :
+	QThread(),
+	hotkeyPrivate(hotkeyPrivate),
+	shortcuts(shortcuts),
+	eventsPerSecond(eventsPerSecond),
+	stopRequested(false)
+{
+	setObjectName(QStringLiteral("QHotkeyInjector"));
+}
+
+void QHotkeyPrivateVirtual::InjectionThread::stop()
+{
+	stopRequested = true;
+	wait();
+}
+
+void QHotkeyPrivateVirtual::InjectionThread::run()
+{
+	using Clock = std::chrono::steady_clock;
+	const Clock::time_point start = Clock::now();
+	const double nsecsPerEvent = eventsPerSecond > 0 ? 1e9 / eventsPerSecond : 0.0;
+
+	quint64 events = 0;
+	for(int index = 0; !stopRequested.load(std::memory_order_relaxed); index = (index + 1) % shortcuts.size()) {
+		if(nsecsPerEvent > 0) {
+			// pace against the start time, so sleeping too long is caught up by the following events
+			const Clock::time_point due = start + std::chrono::nanoseconds(static_cast<qint64>(events * nsecsPerEvent));
+			const auto ahead = std::chrono::duration_cast<std::chrono::microseconds>(due - Clock::now()).count();
+			if(ahead > 0)
+				QThread::usleep(static_cast<unsigned long>(ahead));
+		}
+
+		const QHotkey::NativeShortcut shortcut = shortcuts.at(index);
+		hotkeyPrivate->injectPress(shortcut);
+		hotkeyPrivate->injectRelease(shortcut);
+		events += 2;
+	}
+}
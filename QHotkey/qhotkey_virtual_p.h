@@ -0,0 +1,99 @@
+#ifndef QHOTKEY_VIRTUAL_P_H
+#define QHOTKEY_VIRTUAL_P_H
+
+#include "qhotkey_p.h"
+#include <QSet>
+#include <QThread>
+
+// in memory backend without any display server, for headless tests and load generation.
+// Native shortcuts are the plain Qt::Key and Qt::KeyboardModifiers values
+class QHOTKEY_EXPORT QHotkeyPrivateVirtual : public QHotkeyPrivate
+{
+public:
+	QHotkeyPrivateVirtual();
+	~QHotkeyPrivateVirtual() override;
+
+	static bool isBackendSupported();
+	// nullptr if a different backend was selected
+	static QHotkeyPrivateVirtual *virtualInstance();
+
+	// QAbstractNativeEventFilter interface
+	bool nativeEventFilter(const QByteArray &eventType, void *message, _NATIVE_EVENT_RESULT *result) override;
+
+	// all are threadsafe and behave like events of the listener thread of a real backend. A window reports the event for
+	// the focus window of this application, like X11 does for global grabs, or for the window of a scoped grab
+	void injectPress(QHotkey::NativeShortcut shortcut, WId window = 0);
+	void injectRepeat(QHotkey::NativeShortcut shortcut, WId window = 0);
+	void injectRelease(QHotkey::NativeShortcut shortcut, WId window = 0);
+
+	// press/release pairs of the given shortcuts in turn, on a dedicated thread. A rate of 0 injects as fast as possible
+	bool startInjection(const QList<QHotkey::NativeShortcut> &shortcuts, int eventsPerSecond);
+	void stopInjection();
+	bool isInjecting() const;
+	quint64 injectedEvents() const;
+
+	bool isShortcutGrabbed(QHotkey::NativeShortcut shortcut) const;
+	bool isWindowShortcutGrabbed(QHotkey::NativeShortcut shortcut, WId window) const;
+	int grabCount() const;
+	// lets registering the shortcut fail, to test error handling
+	void setShortcutRejected(QHotkey::NativeShortcut shortcut, bool rejected);
+
+protected:
+	// QHotkeyPrivate interface
+	quint32 nativeKeycode(Qt::Key keycode, bool &ok) Q_DECL_OVERRIDE;
+	quint32 nativeModifiers(Qt::KeyboardModifiers modifiers, bool &ok) Q_DECL_OVERRIDE;
+	bool registerShortcut(QHotkey::NativeShortcut shortcut) Q_DECL_OVERRIDE;
+	bool unregisterShortcut(QHotkey::NativeShortcut shortcut) Q_DECL_OVERRIDE;
+	QList<QHotkey::NativeShortcut> registerWindowShortcuts(const QList<QHotkey::NativeShortcut> &shortcuts, WId window) Q_DECL_OVERRIDE;
+	QList<QHotkey::NativeShortcut> unregisterWindowShortcuts(const QList<QHotkey::NativeShortcut> &shortcuts, WId window) Q_DECL_OVERRIDE;
+	bool setListenerThread(bool enabled) Q_DECL_OVERRIDE;
+	bool isThreadSafe() const Q_DECL_OVERRIDE;
+	QByteArray traceEventType() const Q_DECL_OVERRIDE;
+	void prepareReplay(QByteArray &message) Q_DECL_OVERRIDE;
+
+private:
+	// the native event of this backend. Injected events are handled as these, so they can be traced and replayed
+	struct Message {
+		quint64 window;
+		quint32 type;
+		quint32 key;
+		quint32 modifier;
+		quint32 reserved;//always 0, so the traced struct has no padding
+	};
+	enum MessageType : quint32 {
+		PressMessage,
+		RepeatMessage,
+		ReleaseMessage,
+		InvalidMessage
+	};
+
+	class InjectionThread : public QThread
+	{
+	public:
+		InjectionThread(QHotkeyPrivateVirtual *hotkeyPrivate, const QList<QHotkey::NativeShortcut> &shortcuts, int eventsPerSecond);
+
+		void stop();
+
+	protected:
+		void run() override;
+
+	private:
+		QHotkeyPrivateVirtual *hotkeyPrivate;
+		const QList<QHotkey::NativeShortcut> shortcuts;
+		const int eventsPerSecond;
+		std::atomic<bool> stopRequested;
+	};
+
+	mutable QMutex grabMutex;
+	QSet<QHotkey::NativeShortcut> grabs;
+	QSet<QPair<WId, QHotkey::NativeShortcut>> windowGrabs;
+	QSet<QHotkey::NativeShortcut> rejected;
+
+	InjectionThread *injector;
+	std::atomic<quint64> injected;
+
+	static Message createMessage(MessageType type, QHotkey::NativeShortcut shortcut, WId window);
+	void handleMessage(const Message &message);
+};
+
+#endif // QHOTKEY_VIRTUAL_P_H
@@ -4,6 +4,7 @@
 #include <algorithm>
 #include <QDebug>
 #include <QList>
+#include <QSet>
 #include <QTimer>
 
 #define HKEY_ID(nativeShortcut) (((nativeShortcut.key ^ (nativeShortcut.modifier << 8)) & 0x0FFF) | 0x7000)
@@ -16,6 +17,7 @@ class QHotkeyPrivateWin : public QHotkeyPrivate
 {
 public:
 	QHotkeyPrivateWin();
+	static bool isBackendSupported();
 	// QAbstractNativeEventFilter interface
 	bool nativeEventFilter(const QByteArray &eventType, void *message, _NATIVE_EVENT_RESULT *result) override;
 
@@ -26,20 +28,23 @@ protected:
 	quint32 nativeModifiers(Qt::KeyboardModifiers modifiers, bool &ok) Q_DECL_OVERRIDE;
 	bool registerShortcut(QHotkey::NativeShortcut shortcut) Q_DECL_OVERRIDE;
 	bool unregisterShortcut(QHotkey::NativeShortcut shortcut) Q_DECL_OVERRIDE;
+	void setShortcutRepeats(QHotkey::NativeShortcut shortcut, bool repeats) Q_DECL_OVERRIDE;
 
 private:
 	static QString formatWinError(DWORD winError);
 	QTimer pollTimer;
 	QList<QHotkey::NativeShortcut> polledShortcuts;
+	// registered without MOD_NOREPEAT, because one of their hotkeys does not ignore repeats
+	QSet<QHotkey::NativeShortcut> repeatedShortcuts;
 };
-NATIVE_INSTANCE(QHotkeyPrivateWin)
+NATIVE_BACKEND(QHotkeyPrivateWin, Win)
 
 QHotkeyPrivateWin::QHotkeyPrivateWin(){
 	pollTimer.setInterval(50);
 	connect(&pollTimer, &QTimer::timeout, this, &QHotkeyPrivateWin::pollForHotkeyRelease);
 }
 
-bool QHotkeyPrivate::isPlatformSupported()
+bool QHotkeyPrivateWin::isBackendSupported()
 {
 	return true;
 }
@@ -52,7 +57,18 @@ bool QHotkeyPrivateWin::nativeEventFilter(const QByteArray &eventType, void *mes
 	MSG* msg = static_cast<MSG*>(message);
 	if(msg->message == WM_HOTKEY) {
 		QHotkey::NativeShortcut shortcut = {HIWORD(msg->lParam), LOWORD(msg->lParam)};
-		this->activateShortcut(shortcut);
+		// shortcuts registered without MOD_NOREPEAT send WM_HOTKEY again while held, until the release is polled
+		const QHotkeyEvent event(shortcut,
+								 shortcut.key,
+								 shortcut.modifier,
+								 msg->time,
+								 QHotkeyEvent::currentNsecs(),
+								 this->polledShortcuts.contains(shortcut));
+		if(event.isRepeat()) {
+			this->repeatShortcut(event);
+			return false;
+		}
+		this->activateShortcut(event);
 		if (this->polledShortcuts.empty())
 			this->pollTimer.start();
 		this->polledShortcuts.append(shortcut);
@@ -269,7 +285,7 @@ bool QHotkeyPrivateWin::registerShortcut(QHotkey::NativeShortcut shortcut)
 {
 	BOOL ok = RegisterHotKey(NULL,
 							 HKEY_ID(shortcut),
-							 shortcut.modifier + MOD_NOREPEAT,
+							 shortcut.modifier + (repeatedShortcuts.contains(shortcut) ? 0 : MOD_NOREPEAT),
 							 shortcut.key);
 	if(ok)
 		return true;
@@ -281,6 +297,7 @@ bool QHotkeyPrivateWin::registerShortcut(QHotkey::NativeShortcut shortcut)
 
 bool QHotkeyPrivateWin::unregisterShortcut(QHotkey::NativeShortcut shortcut)
 {
+	repeatedShortcuts.remove(shortcut);
 	BOOL ok = UnregisterHotKey(NULL, HKEY_ID(shortcut));
 	if(ok)
 		return true;
@@ -290,6 +307,21 @@ bool QHotkeyPrivateWin::unregisterShortcut(QHotkey::NativeShortcut shortcut)
 	}
 }
 
+void QHotkeyPrivateWin::setShortcutRepeats(QHotkey::NativeShortcut shortcut, bool repeats)
+{
+	if(repeatedShortcuts.contains(shortcut) == repeats)
+		return;
+	// the flag cannot be changed on a registered hotkey, so it is registered again
+	if(!UnregisterHotKey(NULL, HKEY_ID(shortcut)))
+		return;
+	if(repeats)
+		repeatedShortcuts.insert(shortcut);
+	else
+		repeatedShortcuts.remove(shortcut);
+	if(!registerShortcut(shortcut))
+		qCWarning(logQHotkey) << "Failed to register the hotkey again with changed repeats:" << error;
+}
+
 QString QHotkeyPrivateWin::formatWinError(DWORD winError)
 {
 	wchar_t *buffer = NULL;
@@ -8,19 +8,363 @@
 	#include <QX11Info>
 #endif
 
+#include <QSet>
+#include <QThread>
 #include <QThreadStorage>
 #include <QTimer>
 #include <X11/Xlib.h>
+#include <X11/XKBlib.h>
+#include <X11/keysym.h>
+#include <X11/XF86keysym.h>
 #include <xcb/xcb.h>
+#include <xcb/xkb.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdlib>
 
-//compatibility to pre Qt 5.8
-#ifndef Q_FALLTHROUGH
-#define Q_FALLTHROUGH() (void)0
-#endif
+namespace {
+
+struct KeysymEntry
+{
+	Qt::Key key;
+	KeySym keysym;
+};
+
+// all keys that are not characters, sorted by Qt::Key for a binary search. Multimedia keys use the XF86 keysyms,
+// and the Qt modifier keys the left physical keys; the right ones can be used with a native shortcut
+constexpr KeysymEntry keysymTable[] = {
+	{Qt::Key_Escape, XK_Escape},
+	{Qt::Key_Tab, XK_Tab},
+	{Qt::Key_Backtab, XK_ISO_Left_Tab},
+	{Qt::Key_Backspace, XK_BackSpace},
+	{Qt::Key_Return, XK_Return},
+	{Qt::Key_Enter, XK_KP_Enter},
+	{Qt::Key_Insert, XK_Insert},
+	{Qt::Key_Delete, XK_Delete},
+	{Qt::Key_Pause, XK_Pause},
+	{Qt::Key_Print, XK_Print},
+	{Qt::Key_SysReq, XK_Sys_Req},
+	{Qt::Key_Clear, XK_Clear},
+	{Qt::Key_Home, XK_Home},
+	{Qt::Key_End, XK_End},
+	{Qt::Key_Left, XK_Left},
+	{Qt::Key_Up, XK_Up},
+	{Qt::Key_Right, XK_Right},
+	{Qt::Key_Down, XK_Down},
+	{Qt::Key_PageUp, XK_Prior},
+	{Qt::Key_PageDown, XK_Next},
+	{Qt::Key_Shift, XK_Shift_L},
+	{Qt::Key_Control, XK_Control_L},
+	{Qt::Key_Meta, XK_Super_L},
+	{Qt::Key_Alt, XK_Alt_L},
+	{Qt::Key_CapsLock, XK_Caps_Lock},
+	{Qt::Key_NumLock, XK_Num_Lock},
+	{Qt::Key_ScrollLock, XK_Scroll_Lock},
+	{Qt::Key_F1, XK_F1},
+	{Qt::Key_F2, XK_F2},
+	{Qt::Key_F3, XK_F3},
+	{Qt::Key_F4, XK_F4},
+	{Qt::Key_F5, XK_F5},
+	{Qt::Key_F6, XK_F6},
+	{Qt::Key_F7, XK_F7},
+	{Qt::Key_F8, XK_F8},
+	{Qt::Key_F9, XK_F9},
+	{Qt::Key_F10, XK_F10},
+	{Qt::Key_F11, XK_F11},
+	{Qt::Key_F12, XK_F12},
+	{Qt::Key_F13, XK_F13},
+	{Qt::Key_F14, XK_F14},
+	{Qt::Key_F15, XK_F15},
+	{Qt::Key_F16, XK_F16},
+	{Qt::Key_F17, XK_F17},
+	{Qt::Key_F18, XK_F18},
+	{Qt::Key_F19, XK_F19},
+	{Qt::Key_F20, XK_F20},
+	{Qt::Key_F21, XK_F21},
+	{Qt::Key_F22, XK_F22},
+	{Qt::Key_F23, XK_F23},
+	{Qt::Key_F24, XK_F24},
+	{Qt::Key_F25, XK_F25},
+	{Qt::Key_F26, XK_F26},
+	{Qt::Key_F27, XK_F27},
+	{Qt::Key_F28, XK_F28},
+	{Qt::Key_F29, XK_F29},
+	{Qt::Key_F30, XK_F30},
+	{Qt::Key_F31, XK_F31},
+	{Qt::Key_F32, XK_F32},
+	{Qt::Key_F33, XK_F33},
+	{Qt::Key_F34, XK_F34},
+	{Qt::Key_F35, XK_F35},
+	{Qt::Key_Super_L, XK_Super_L},
+	{Qt::Key_Super_R, XK_Super_R},
+	{Qt::Key_Menu, XK_Menu},
+	{Qt::Key_Hyper_L, XK_Hyper_L},
+	{Qt::Key_Hyper_R, XK_Hyper_R},
+	{Qt::Key_Help, XK_Help},
+	{Qt::Key_Back, XF86XK_Back},
+	{Qt::Key_Forward, XF86XK_Forward},
+	{Qt::Key_Stop, XF86XK_Stop},
+	{Qt::Key_Refresh, XF86XK_Refresh},
+	{Qt::Key_VolumeDown, XF86XK_AudioLowerVolume},
+	{Qt::Key_VolumeMute, XF86XK_AudioMute},
+	{Qt::Key_VolumeUp, XF86XK_AudioRaiseVolume},
+	{Qt::Key_MediaPlay, XF86XK_AudioPlay},
+	{Qt::Key_MediaStop, XF86XK_AudioStop},
+	{Qt::Key_MediaPrevious, XF86XK_AudioPrev},
+	{Qt::Key_MediaNext, XF86XK_AudioNext},
+	{Qt::Key_MediaRecord, XF86XK_AudioRecord},
+	{Qt::Key_MediaPause, XF86XK_AudioPause},
+	{Qt::Key_MediaTogglePlayPause, XF86XK_AudioPlay},
+	{Qt::Key_HomePage, XF86XK_HomePage},
+	{Qt::Key_Favorites, XF86XK_Favorites},
+	{Qt::Key_Search, XF86XK_Search},
+	{Qt::Key_Standby, XF86XK_Standby},
+	{Qt::Key_OpenUrl, XF86XK_OpenURL},
+	{Qt::Key_LaunchMail, XF86XK_Mail},
+	{Qt::Key_LaunchMedia, XF86XK_AudioMedia},
+	{Qt::Key_Launch0, XF86XK_Launch0},
+	{Qt::Key_Launch1, XF86XK_Launch1},
+	{Qt::Key_Launch2, XF86XK_Launch2},
+	{Qt::Key_Launch3, XF86XK_Launch3},
+	{Qt::Key_Launch4, XF86XK_Launch4},
+	{Qt::Key_Launch5, XF86XK_Launch5},
+	{Qt::Key_Launch6, XF86XK_Launch6},
+	{Qt::Key_Launch7, XF86XK_Launch7},
+	{Qt::Key_Launch8, XF86XK_Launch8},
+	{Qt::Key_Launch9, XF86XK_Launch9},
+	{Qt::Key_LaunchA, XF86XK_LaunchA},
+	{Qt::Key_LaunchB, XF86XK_LaunchB},
+	{Qt::Key_LaunchC, XF86XK_LaunchC},
+	{Qt::Key_LaunchD, XF86XK_LaunchD},
+	{Qt::Key_LaunchE, XF86XK_LaunchE},
+	{Qt::Key_LaunchF, XF86XK_LaunchF},
+	{Qt::Key_MonBrightnessUp, XF86XK_MonBrightnessUp},
+	{Qt::Key_MonBrightnessDown, XF86XK_MonBrightnessDown},
+	{Qt::Key_KeyboardLightOnOff, XF86XK_KbdLightOnOff},
+	{Qt::Key_KeyboardBrightnessUp, XF86XK_KbdBrightnessUp},
+	{Qt::Key_KeyboardBrightnessDown, XF86XK_KbdBrightnessDown},
+	{Qt::Key_PowerOff, XF86XK_PowerOff},
+	{Qt::Key_WakeUp, XF86XK_WakeUp},
+	{Qt::Key_Eject, XF86XK_Eject},
+	{Qt::Key_ScreenSaver, XF86XK_ScreenSaver},
+	{Qt::Key_WWW, XF86XK_WWW},
+	{Qt::Key_Calculator, XF86XK_Calculator},
+	{Qt::Key_Copy, XF86XK_Copy},
+	{Qt::Key_Cut, XF86XK_Cut},
+	{Qt::Key_Paste, XF86XK_Paste},
+	{Qt::Key_Reload, XF86XK_Reload},
+	{Qt::Key_Save, XF86XK_Save},
+	{Qt::Key_Send, XF86XK_Send},
+	{Qt::Key_Terminal, XF86XK_Terminal},
+	{Qt::Key_ZoomIn, XF86XK_ZoomIn},
+	{Qt::Key_ZoomOut, XF86XK_ZoomOut},
+	{Qt::Key_Battery, XF86XK_Battery},
+	{Qt::Key_Bluetooth, XF86XK_Bluetooth},
+	{Qt::Key_WLAN, XF86XK_WLAN},
+	{Qt::Key_Hibernate, XF86XK_Hibernate},
+	{Qt::Key_Suspend, XF86XK_Suspend},
+	{Qt::Key_TouchpadToggle, XF86XK_TouchpadToggle},
+	{Qt::Key_TouchpadOn, XF86XK_TouchpadOn},
+	{Qt::Key_TouchpadOff, XF86XK_TouchpadOff},
+	{Qt::Key_MicMute, XF86XK_AudioMicMute},
+	{Qt::Key_AltGr, XK_ISO_Level3_Shift},
+	{Qt::Key_Multi_key, XK_Multi_key},
+	{Qt::Key_Mode_switch, XK_Mode_switch},
+	{Qt::Key_Select, XK_Select},
+	{Qt::Key_Cancel, XK_Cancel},
+	{Qt::Key_Execute, XK_Execute},
+	{Qt::Key_Sleep, XF86XK_Sleep}
+};
+
+constexpr bool isSortedByKey(const KeysymEntry *table, std::size_t size)
+{
+	return size < 2 || (table[0].key < table[1].key && isSortedByKey(table + 1, size - 1));
+}
+static_assert(isSortedByKey(keysymTable, sizeof(keysymTable) / sizeof(keysymTable[0])), "keysymTable must be sorted by Qt::Key");
+
+struct UnicodeKeysym
+{
+	quint16 ucs;
+	quint16 keysym;
+};
+
+// the legacy keysyms of keysymdef.h with an exact unicode equivalent beyond Latin-1, sorted by their character. Many
+// layouts, like the Cyrillic or Greek ones, report these instead of the unicode keysyms
+constexpr UnicodeKeysym legacyKeysymTable[] = {
+	{0x0100, 0x03c0}, {0x0101, 0x03e0}, {0x0102, 0x01c3}, {0x0103, 0x01e3}, {0x0104, 0x01a1}, {0x0105, 0x01b1},
+	{0x0106, 0x01c6}, {0x0107, 0x01e6}, {0x0108, 0x02c6}, {0x0109, 0x02e6}, {0x010a, 0x02c5}, {0x010b, 0x02e5},
+	{0x010c, 0x01c8}, {0x010d, 0x01e8}, {0x010e, 0x01cf}, {0x010f, 0x01ef}, {0x0110, 0x01d0}, {0x0111, 0x01f0},
+	{0x0112, 0x03aa}, {0x0113, 0x03ba}, {0x0116, 0x03cc}, {0x0117, 0x03ec}, {0x0118, 0x01ca}, {0x0119, 0x01ea},
+	{0x011a, 0x01cc}, {0x011b, 0x01ec}, {0x011c, 0x02d8}, {0x011d, 0x02f8}, {0x011e, 0x02ab}, {0x011f, 0x02bb},
+	{0x0120, 0x02d5}, {0x0121, 0x02f5}, {0x0122, 0x03ab}, {0x0123, 0x03bb}, {0x0124, 0x02a6}, {0x0125, 0x02b6},
+	{0x0126, 0x02a1}, {0x0127, 0x02b1}, {0x0128, 0x03a5}, {0x0129, 0x03b5}, {0x012a, 0x03cf}, {0x012b, 0x03ef},
+	{0x012e, 0x03c7}, {0x012f, 0x03e7}, {0x0130, 0x02a9}, {0x0131, 0x02b9}, {0x0134, 0x02ac}, {0x0135, 0x02bc},
+	{0x0136, 0x03d3}, {0x0137, 0x03f3}, {0x0138, 0x03a2}, {0x0139, 0x01c5}, {0x013a, 0x01e5}, {0x013b, 0x03a6},
+	{0x013c, 0x03b6}, {0x013d, 0x01a5}, {0x013e, 0x01b5}, {0x0141, 0x01a3}, {0x0142, 0x01b3}, {0x0143, 0x01d1},
+	{0x0144, 0x01f1}, {0x0145, 0x03d1}, {0x0146, 0x03f1}, {0x0147, 0x01d2}, {0x0148, 0x01f2}, {0x014a, 0x03bd},
+	{0x014b, 0x03bf}, {0x014c, 0x03d2}, {0x014d, 0x03f2}, {0x0150, 0x01d5}, {0x0151, 0x01f5}, {0x0152, 0x13bc},
+	{0x0153, 0x13bd}, {0x0154, 0x01c0}, {0x0155, 0x01e0}, {0x0156, 0x03a3}, {0x0157, 0x03b3}, {0x0158, 0x01d8},
+	{0x0159, 0x01f8}, {0x015a, 0x01a6}, {0x015b, 0x01b6}, {0x015c, 0x02de}, {0x015d, 0x02fe}, {0x015e, 0x01aa},
+	{0x015f, 0x01ba}, {0x0160, 0x01a9}, {0x0161, 0x01b9}, {0x0162, 0x01de}, {0x0163, 0x01fe}, {0x0164, 0x01ab},
+	{0x0165, 0x01bb}, {0x0166, 0x03ac}, {0x0167, 0x03bc}, {0x0168, 0x03dd}, {0x0169, 0x03fd}, {0x016a, 0x03de},
+	{0x016b, 0x03fe}, {0x016c, 0x02dd}, {0x016d, 0x02fd}, {0x016e, 0x01d9}, {0x016f, 0x01f9}, {0x0170, 0x01db},
+	{0x0171, 0x01fb}, {0x0172, 0x03d9}, {0x0173, 0x03f9}, {0x0178, 0x13be}, {0x0179, 0x01ac}, {0x017a, 0x01bc},
+	{0x017b, 0x01af}, {0x017c, 0x01bf}, {0x017d, 0x01ae}, {0x017e, 0x01be}, {0x0192, 0x08f6}, {0x02c7, 0x01b7},
+	{0x02d8, 0x01a2}, {0x02d9, 0x01ff}, {0x02db, 0x01b2}, {0x02dd, 0x01bd}, {0x0385, 0x07ae}, {0x0386, 0x07a1},
+	{0x0388, 0x07a2}, {0x0389, 0x07a3}, {0x038a, 0x07a4}, {0x038c, 0x07a7}, {0x038e, 0x07a8}, {0x038f, 0x07ab},
+	{0x0390, 0x07b6}, {0x0391, 0x07c1}, {0x0392, 0x07c2}, {0x0393, 0x07c3}, {0x0394, 0x07c4}, {0x0395, 0x07c5},
+	{0x0396, 0x07c6}, {0x0397, 0x07c7}, {0x0398, 0x07c8}, {0x0399, 0x07c9}, {0x039a, 0x07ca}, {0x039b, 0x07cb},
+	{0x039c, 0x07cc}, {0x039d, 0x07cd}, {0x039e, 0x07ce}, {0x039f, 0x07cf}, {0x03a0, 0x07d0}, {0x03a1, 0x07d1},
+	{0x03a3, 0x07d2}, {0x03a4, 0x07d4}, {0x03a5, 0x07d5}, {0x03a6, 0x07d6}, {0x03a7, 0x07d7}, {0x03a8, 0x07d8},
+	{0x03a9, 0x07d9}, {0x03aa, 0x07a5}, {0x03ab, 0x07a9}, {0x03ac, 0x07b1}, {0x03ad, 0x07b2}, {0x03ae, 0x07b3},
+	{0x03af, 0x07b4}, {0x03b0, 0x07ba}, {0x03b1, 0x07e1}, {0x03b2, 0x07e2}, {0x03b3, 0x07e3}, {0x03b4, 0x07e4},
+	{0x03b5, 0x07e5}, {0x03b6, 0x07e6}, {0x03b7, 0x07e7}, {0x03b8, 0x07e8}, {0x03b9, 0x07e9}, {0x03ba, 0x07ea},
+	{0x03bb, 0x07eb}, {0x03bc, 0x07ec}, {0x03bd, 0x07ed}, {0x03be, 0x07ee}, {0x03bf, 0x07ef}, {0x03c0, 0x07f0},
+	{0x03c1, 0x07f1}, {0x03c2, 0x07f3}, {0x03c3, 0x07f2}, {0x03c4, 0x07f4}, {0x03c5, 0x07f5}, {0x03c6, 0x07f6},
+	{0x03c7, 0x07f7}, {0x03c8, 0x07f8}, {0x03c9, 0x07f9}, {0x03ca, 0x07b5}, {0x03cb, 0x07b9}, {0x03cc, 0x07b7},
+	{0x03cd, 0x07b8}, {0x03ce, 0x07bb}, {0x0401, 0x06b3}, {0x0402, 0x06b1}, {0x0403, 0x06b2}, {0x0404, 0x06b4},
+	{0x0405, 0x06b5}, {0x0406, 0x06b6}, {0x0407, 0x06b7}, {0x0408, 0x06b8}, {0x0409, 0x06b9}, {0x040a, 0x06ba},
+	{0x040b, 0x06bb}, {0x040c, 0x06bc}, {0x040e, 0x06be}, {0x040f, 0x06bf}, {0x0410, 0x06e1}, {0x0411, 0x06e2},
+	{0x0412, 0x06f7}, {0x0413, 0x06e7}, {0x0414, 0x06e4}, {0x0415, 0x06e5}, {0x0416, 0x06f6}, {0x0417, 0x06fa},
+	{0x0418, 0x06e9}, {0x0419, 0x06ea}, {0x041a, 0x06eb}, {0x041b, 0x06ec}, {0x041c, 0x06ed}, {0x041d, 0x06ee},
+	{0x041e, 0x06ef}, {0x041f, 0x06f0}, {0x0420, 0x06f2}, {0x0421, 0x06f3}, {0x0422, 0x06f4}, {0x0423, 0x06f5},
+	{0x0424, 0x06e6}, {0x0425, 0x06e8}, {0x0426, 0x06e3}, {0x0427, 0x06fe}, {0x0428, 0x06fb}, {0x0429, 0x06fd},
+	{0x042a, 0x06ff}, {0x042b, 0x06f9}, {0x042c, 0x06f8}, {0x042d, 0x06fc}, {0x042e, 0x06e0}, {0x042f, 0x06f1},
+	{0x0430, 0x06c1}, {0x0431, 0x06c2}, {0x0432, 0x06d7}, {0x0433, 0x06c7}, {0x0434, 0x06c4}, {0x0435, 0x06c5},
+	{0x0436, 0x06d6}, {0x0437, 0x06da}, {0x0438, 0x06c9}, {0x0439, 0x06ca}, {0x043a, 0x06cb}, {0x043b, 0x06cc},
+	{0x043c, 0x06cd}, {0x043d, 0x06ce}, {0x043e, 0x06cf}, {0x043f, 0x06d0}, {0x0440, 0x06d2}, {0x0441, 0x06d3},
+	{0x0442, 0x06d4}, {0x0443, 0x06d5}, {0x0444, 0x06c6}, {0x0445, 0x06c8}, {0x0446, 0x06c3}, {0x0447, 0x06de},
+	{0x0448, 0x06db}, {0x0449, 0x06dd}, {0x044a, 0x06df}, {0x044b, 0x06d9}, {0x044c, 0x06d8}, {0x044d, 0x06dc},
+	{0x044e, 0x06c0}, {0x044f, 0x06d1}, {0x0451, 0x06a3}, {0x0452, 0x06a1}, {0x0453, 0x06a2}, {0x0454, 0x06a4},
+	{0x0455, 0x06a5}, {0x0456, 0x06a6}, {0x0457, 0x06a7}, {0x0458, 0x06a8}, {0x0459, 0x06a9}, {0x045a, 0x06aa},
+	{0x045b, 0x06ab}, {0x045c, 0x06ac}, {0x045e, 0x06ae}, {0x045f, 0x06af}, {0x0490, 0x06bd}, {0x0491, 0x06ad},
+	{0x05d0, 0x0ce0}, {0x05d1, 0x0ce1}, {0x05d2, 0x0ce2}, {0x05d3, 0x0ce3}, {0x05d4, 0x0ce4}, {0x05d5, 0x0ce5},
+	{0x05d6, 0x0ce6}, {0x05d7, 0x0ce7}, {0x05d8, 0x0ce8}, {0x05d9, 0x0ce9}, {0x05da, 0x0cea}, {0x05db, 0x0ceb},
+	{0x05dc, 0x0cec}, {0x05dd, 0x0ced}, {0x05de, 0x0cee}, {0x05df, 0x0cef}, {0x05e0, 0x0cf0}, {0x05e1, 0x0cf1},
+	{0x05e2, 0x0cf2}, {0x05e3, 0x0cf3}, {0x05e4, 0x0cf4}, {0x05e5, 0x0cf5}, {0x05e6, 0x0cf6}, {0x05e7, 0x0cf7},
+	{0x05e8, 0x0cf8}, {0x05e9, 0x0cf9}, {0x05ea, 0x0cfa}, {0x060c, 0x05ac}, {0x061b, 0x05bb}, {0x061f, 0x05bf},
+	{0x0621, 0x05c1}, {0x0622, 0x05c2}, {0x0623, 0x05c3}, {0x0624, 0x05c4}, {0x0625, 0x05c5}, {0x0626, 0x05c6},
+	{0x0627, 0x05c7}, {0x0628, 0x05c8}, {0x0629, 0x05c9}, {0x062a, 0x05ca}, {0x062b, 0x05cb}, {0x062c, 0x05cc},
+	{0x062d, 0x05cd}, {0x062e, 0x05ce}, {0x062f, 0x05cf}, {0x0630, 0x05d0}, {0x0631, 0x05d1}, {0x0632, 0x05d2},
+	{0x0633, 0x05d3}, {0x0634, 0x05d4}, {0x0635, 0x05d5}, {0x0636, 0x05d6}, {0x0637, 0x05d7}, {0x0638, 0x05d8},
+	{0x0639, 0x05d9}, {0x063a, 0x05da}, {0x0640, 0x05e0}, {0x0641, 0x05e1}, {0x0642, 0x05e2}, {0x0643, 0x05e3},
+	{0x0644, 0x05e4}, {0x0645, 0x05e5}, {0x0646, 0x05e6}, {0x0647, 0x05e7}, {0x0648, 0x05e8}, {0x0649, 0x05e9},
+	{0x064a, 0x05ea}, {0x064b, 0x05eb}, {0x064c, 0x05ec}, {0x064d, 0x05ed}, {0x064e, 0x05ee}, {0x064f, 0x05ef},
+	{0x0650, 0x05f0}, {0x0651, 0x05f1}, {0x0652, 0x05f2}, {0x0e01, 0x0da1}, {0x0e02, 0x0da2}, {0x0e03, 0x0da3},
+	{0x0e04, 0x0da4}, {0x0e05, 0x0da5}, {0x0e06, 0x0da6}, {0x0e07, 0x0da7}, {0x0e08, 0x0da8}, {0x0e09, 0x0da9},
+	{0x0e0a, 0x0daa}, {0x0e0b, 0x0dab}, {0x0e0c, 0x0dac}, {0x0e0d, 0x0dad}, {0x0e0e, 0x0dae}, {0x0e0f, 0x0daf},
+	{0x0e10, 0x0db0}, {0x0e11, 0x0db1}, {0x0e12, 0x0db2}, {0x0e13, 0x0db3}, {0x0e14, 0x0db4}, {0x0e15, 0x0db5},
+	{0x0e16, 0x0db6}, {0x0e17, 0x0db7}, {0x0e18, 0x0db8}, {0x0e19, 0x0db9}, {0x0e1a, 0x0dba}, {0x0e1b, 0x0dbb},
+	{0x0e1c, 0x0dbc}, {0x0e1d, 0x0dbd}, {0x0e1e, 0x0dbe}, {0x0e1f, 0x0dbf}, {0x0e20, 0x0dc0}, {0x0e21, 0x0dc1},
+	{0x0e22, 0x0dc2}, {0x0e23, 0x0dc3}, {0x0e24, 0x0dc4}, {0x0e25, 0x0dc5}, {0x0e26, 0x0dc6}, {0x0e27, 0x0dc7},
+	{0x0e28, 0x0dc8}, {0x0e29, 0x0dc9}, {0x0e2a, 0x0dca}, {0x0e2b, 0x0dcb}, {0x0e2c, 0x0dcc}, {0x0e2d, 0x0dcd},
+	{0x0e2e, 0x0dce}, {0x0e2f, 0x0dcf}, {0x0e30, 0x0dd0}, {0x0e31, 0x0dd1}, {0x0e32, 0x0dd2}, {0x0e33, 0x0dd3},
+	{0x0e34, 0x0dd4}, {0x0e35, 0x0dd5}, {0x0e36, 0x0dd6}, {0x0e37, 0x0dd7}, {0x0e38, 0x0dd8}, {0x0e39, 0x0dd9},
+	{0x0e3a, 0x0dda}, {0x0e3f, 0x0ddf}, {0x0e40, 0x0de0}, {0x0e41, 0x0de1}, {0x0e42, 0x0de2}, {0x0e43, 0x0de3},
+	{0x0e44, 0x0de4}, {0x0e45, 0x0de5}, {0x0e46, 0x0de6}, {0x0e47, 0x0de7}, {0x0e48, 0x0de8}, {0x0e49, 0x0de9},
+	{0x0e4a, 0x0dea}, {0x0e4b, 0x0deb}, {0x0e4c, 0x0dec}, {0x0e4d, 0x0ded}, {0x0e50, 0x0df0}, {0x0e51, 0x0df1},
+	{0x0e52, 0x0df2}, {0x0e53, 0x0df3}, {0x0e54, 0x0df4}, {0x0e55, 0x0df5}, {0x0e56, 0x0df6}, {0x0e57, 0x0df7},
+	{0x0e58, 0x0df8}, {0x0e59, 0x0df9}, {0x11a8, 0x0ed4}, {0x11a9, 0x0ed5}, {0x11aa, 0x0ed6}, {0x11ab, 0x0ed7},
+	{0x11ac, 0x0ed8}, {0x11ad, 0x0ed9}, {0x11ae, 0x0eda}, {0x11af, 0x0edb}, {0x11b0, 0x0edc}, {0x11b1, 0x0edd},
+	{0x11b2, 0x0ede}, {0x11b3, 0x0edf}, {0x11b4, 0x0ee0}, {0x11b5, 0x0ee1}, {0x11b6, 0x0ee2}, {0x11b7, 0x0ee3},
+	{0x11b8, 0x0ee4}, {0x11b9, 0x0ee5}, {0x11ba, 0x0ee6}, {0x11bb, 0x0ee7}, {0x11bc, 0x0ee8}, {0x11bd, 0x0ee9},
+	{0x11be, 0x0eea}, {0x11bf, 0x0eeb}, {0x11c0, 0x0eec}, {0x11c1, 0x0eed}, {0x11c2, 0x0eee}, {0x11eb, 0x0ef8},
+	{0x11f0, 0x0ef9}, {0x11f9, 0x0efa}, {0x2002, 0x0aa2}, {0x2003, 0x0aa1}, {0x2004, 0x0aa3}, {0x2005, 0x0aa4},
+	{0x2007, 0x0aa5}, {0x2008, 0x0aa6}, {0x2009, 0x0aa7}, {0x200a, 0x0aa8}, {0x2012, 0x0abb}, {0x2013, 0x0aaa},
+	{0x2014, 0x0aa9}, {0x2015, 0x07af}, {0x2017, 0x0cdf}, {0x2018, 0x0ad0}, {0x2019, 0x0ad1}, {0x201a, 0x0afd},
+	{0x201c, 0x0ad2}, {0x201d, 0x0ad3}, {0x201e, 0x0afe}, {0x2020, 0x0af1}, {0x2021, 0x0af2}, {0x2025, 0x0aaf},
+	{0x2026, 0x0aae}, {0x2030, 0x0ad5}, {0x2032, 0x0ad6}, {0x2033, 0x0ad7}, {0x2038, 0x0afc}, {0x203e, 0x047e},
+	{0x20ac, 0x20ac}, {0x2105, 0x0ab8}, {0x2116, 0x06b0}, {0x2117, 0x0afb}, {0x211e, 0x0ad4}, {0x2122, 0x0ac9},
+	{0x2153, 0x0ab0}, {0x2154, 0x0ab1}, {0x2155, 0x0ab2}, {0x2156, 0x0ab3}, {0x2157, 0x0ab4}, {0x2158, 0x0ab5},
+	{0x2159, 0x0ab6}, {0x215a, 0x0ab7}, {0x215b, 0x0ac3}, {0x215c, 0x0ac4}, {0x215d, 0x0ac5}, {0x215e, 0x0ac6},
+	{0x2190, 0x08fb}, {0x2191, 0x08fc}, {0x2192, 0x08fd}, {0x2193, 0x08fe}, {0x21d2, 0x08ce}, {0x21d4, 0x08cd},
+	{0x2202, 0x08ef}, {0x2207, 0x08c5}, {0x2218, 0x0bca}, {0x221a, 0x08d6}, {0x221d, 0x08c1}, {0x221e, 0x08c2},
+	{0x2227, 0x08de}, {0x2228, 0x08df}, {0x2229, 0x08dc}, {0x222a, 0x08dd}, {0x222b, 0x08bf}, {0x2234, 0x08c0},
+	{0x223c, 0x08c8}, {0x2243, 0x08c9}, {0x2260, 0x08bd}, {0x2261, 0x08cf}, {0x2264, 0x08bc}, {0x2265, 0x08be},
+	{0x2282, 0x08da}, {0x2283, 0x08db}, {0x22a2, 0x0bfc}, {0x22a3, 0x0bdc}, {0x22a4, 0x0bc2}, {0x22a5, 0x0bce},
+	{0x2308, 0x0bd3}, {0x230a, 0x0bc4}, {0x2315, 0x0afa}, {0x2320, 0x08a4}, {0x2321, 0x08a5}, {0x2395, 0x0bcc},
+	{0x239b, 0x08ab}, {0x239d, 0x08ac}, {0x239e, 0x08ad}, {0x23a0, 0x08ae}, {0x23a1, 0x08a7}, {0x23a3, 0x08a8},
+	{0x23a4, 0x08a9}, {0x23a6, 0x08aa}, {0x23a8, 0x08af}, {0x23ac, 0x08b0}, {0x23b7, 0x08a1}, {0x23ba, 0x09ef},
+	{0x23bb, 0x09f0}, {0x23bc, 0x09f2}, {0x23bd, 0x09f3}, {0x2409, 0x09e2}, {0x240a, 0x09e5}, {0x240b, 0x09e9},
+	{0x240c, 0x09e3}, {0x240d, 0x09e4}, {0x2424, 0x09e8}, {0x2500, 0x09f1}, {0x2502, 0x09f8}, {0x250c, 0x09ec},
+	{0x2510, 0x09eb}, {0x2514, 0x09ed}, {0x2518, 0x09ea}, {0x251c, 0x09f4}, {0x2524, 0x09f5}, {0x252c, 0x09f7},
+	{0x2534, 0x09f6}, {0x253c, 0x09ee}, {0x2592, 0x09e1}, {0x25c6, 0x09e0}, {0x25cb, 0x0bcf}, {0x260e, 0x0af9},
+	{0x2640, 0x0af8}, {0x2642, 0x0af7}, {0x2663, 0x0aec}, {0x2665, 0x0aee}, {0x2666, 0x0aed}, {0x266d, 0x0af6},
+	{0x266f, 0x0af5}, {0x2713, 0x0af3}, {0x2717, 0x0af4}, {0x271d, 0x0ad9}, {0x2720, 0x0af0}, {0x3001, 0x04a4},
+	{0x3002, 0x04a1}, {0x300c, 0x04a2}, {0x300d, 0x04a3}, {0x309b, 0x04de}, {0x309c, 0x04df}, {0x30a1, 0x04a7},
+	{0x30a2, 0x04b1}, {0x30a3, 0x04a8}, {0x30a4, 0x04b2}, {0x30a5, 0x04a9}, {0x30a6, 0x04b3}, {0x30a7, 0x04aa},
+	{0x30a8, 0x04b4}, {0x30a9, 0x04ab}, {0x30aa, 0x04b5}, {0x30ab, 0x04b6}, {0x30ad, 0x04b7}, {0x30af, 0x04b8},
+	{0x30b1, 0x04b9}, {0x30b3, 0x04ba}, {0x30b5, 0x04bb}, {0x30b7, 0x04bc}, {0x30b9, 0x04bd}, {0x30bb, 0x04be},
+	{0x30bd, 0x04bf}, {0x30bf, 0x04c0}, {0x30c1, 0x04c1}, {0x30c3, 0x04af}, {0x30c4, 0x04c2}, {0x30c6, 0x04c3},
+	{0x30c8, 0x04c4}, {0x30ca, 0x04c5}, {0x30cb, 0x04c6}, {0x30cc, 0x04c7}, {0x30cd, 0x04c8}, {0x30ce, 0x04c9},
+	{0x30cf, 0x04ca}, {0x30d2, 0x04cb}, {0x30d5, 0x04cc}, {0x30d8, 0x04cd}, {0x30db, 0x04ce}, {0x30de, 0x04cf},
+	{0x30df, 0x04d0}, {0x30e0, 0x04d1}, {0x30e1, 0x04d2}, {0x30e2, 0x04d3}, {0x30e3, 0x04ac}, {0x30e4, 0x04d4},
+	{0x30e5, 0x04ad}, {0x30e6, 0x04d5}, {0x30e7, 0x04ae}, {0x30e8, 0x04d6}, {0x30e9, 0x04d7}, {0x30ea, 0x04d8},
+	{0x30eb, 0x04d9}, {0x30ec, 0x04da}, {0x30ed, 0x04db}, {0x30ef, 0x04dc}, {0x30f2, 0x04a6}, {0x30f3, 0x04dd},
+	{0x30fb, 0x04a5}, {0x30fc, 0x04b0}, {0x3131, 0x0ea1}, {0x3132, 0x0ea2}, {0x3133, 0x0ea3}, {0x3134, 0x0ea4},
+	{0x3135, 0x0ea5}, {0x3136, 0x0ea6}, {0x3137, 0x0ea7}, {0x3138, 0x0ea8}, {0x3139, 0x0ea9}, {0x313a, 0x0eaa},
+	{0x313b, 0x0eab}, {0x313c, 0x0eac}, {0x313d, 0x0ead}, {0x313e, 0x0eae}, {0x313f, 0x0eaf}, {0x3140, 0x0eb0},
+	{0x3141, 0x0eb1}, {0x3142, 0x0eb2}, {0x3143, 0x0eb3}, {0x3144, 0x0eb4}, {0x3145, 0x0eb5}, {0x3146, 0x0eb6},
+	{0x3147, 0x0eb7}, {0x3148, 0x0eb8}, {0x3149, 0x0eb9}, {0x314a, 0x0eba}, {0x314b, 0x0ebb}, {0x314c, 0x0ebc},
+	{0x314d, 0x0ebd}, {0x314e, 0x0ebe}, {0x314f, 0x0ebf}, {0x3150, 0x0ec0}, {0x3151, 0x0ec1}, {0x3152, 0x0ec2},
+	{0x3153, 0x0ec3}, {0x3154, 0x0ec4}, {0x3155, 0x0ec5}, {0x3156, 0x0ec6}, {0x3157, 0x0ec7}, {0x3158, 0x0ec8},
+	{0x3159, 0x0ec9}, {0x315a, 0x0eca}, {0x315b, 0x0ecb}, {0x315c, 0x0ecc}, {0x315d, 0x0ecd}, {0x315e, 0x0ece},
+	{0x315f, 0x0ecf}, {0x3160, 0x0ed0}, {0x3161, 0x0ed1}, {0x3162, 0x0ed2}, {0x3163, 0x0ed3}, {0x316d, 0x0eef},
+	{0x3171, 0x0ef0}, {0x3178, 0x0ef1}, {0x317f, 0x0ef2}, {0x3181, 0x0ef3}, {0x3184, 0x0ef4}, {0x3186, 0x0ef5},
+	{0x318d, 0x0ef6}, {0x318e, 0x0ef7}
+};
+
+// halves the table on each step, so the recursion stays far below the constexpr depth limit
+constexpr bool isSortedByUnicode(const UnicodeKeysym *table, std::size_t size)
+{
+	return size < 2 || (isSortedByUnicode(table, size / 2) &&
+						table[size / 2 - 1].ucs < table[size / 2].ucs &&
+						isSortedByUnicode(table + size / 2, size - size / 2));
+}
+static_assert(isSortedByUnicode(legacyKeysymTable, sizeof(legacyKeysymTable) / sizeof(legacyKeysymTable[0])), "legacyKeysymTable must be sorted by character");
+
+// independent of the locale and without any allocation, unlike going through the native text of a QKeySequence
+KeySym qtKeyToKeysym(Qt::Key key)
+{
+	// Latin-1 characters share their values with their keysyms, all others use the unicode keysyms
+	if(key < 0x20)
+		return NoSymbol;
+	if(key <= 0xff)
+		return static_cast<KeySym>(key);
+	if(key < 0x01000000)
+		return static_cast<KeySym>(0x01000000 | key);
+
+	const KeysymEntry *end = keysymTable + sizeof(keysymTable) / sizeof(keysymTable[0]);
+	const KeysymEntry *entry = std::lower_bound(keysymTable, end, key, [](const KeysymEntry &lhs, Qt::Key rhs) {
+		return lhs.key < rhs;
+	});
+	return entry != end && entry->key == key ? entry->keysym : NoSymbol;
+}
+
+KeySym legacyKeysym(Qt::Key key)
+{
+	if(key <= 0xff || key > 0xffff)
+		return NoSymbol;
+
+	const UnicodeKeysym *end = legacyKeysymTable + sizeof(legacyKeysymTable) / sizeof(legacyKeysymTable[0]);
+	const UnicodeKeysym *entry = std::lower_bound(legacyKeysymTable, end, key, [](const UnicodeKeysym &lhs, Qt::Key rhs) {
+		return lhs.ucs < rhs;
+	});
+	return entry != end && entry->ucs == key ? entry->keysym : NoSymbol;
+}
+
+// core and XKB events are 32 bytes on the wire, xcb only appends the full sequence number to them
+const int TracedEventSize = 32;
+
+}
 
 class QHotkeyPrivateX11 : public QHotkeyPrivate
 {
 public:
+	QHotkeyPrivateX11();
+	~QHotkeyPrivateX11() override;
+	static bool isBackendSupported();
 	// QAbstractNativeEventFilter interface
 	bool nativeEventFilter(const QByteArray &eventType, void *message, _NATIVE_EVENT_RESULT *result) override;
 
@@ -28,38 +372,99 @@ protected:
 	// QHotkeyPrivate interface
 	quint32 nativeKeycode(Qt::Key keycode, bool &ok) Q_DECL_OVERRIDE;
 	quint32 nativeModifiers(Qt::KeyboardModifiers modifiers, bool &ok) Q_DECL_OVERRIDE;
-	static QString getX11String(Qt::Key keycode);
 	bool registerShortcut(QHotkey::NativeShortcut shortcut) Q_DECL_OVERRIDE;
 	bool unregisterShortcut(QHotkey::NativeShortcut shortcut) Q_DECL_OVERRIDE;
+	QList<QHotkey::NativeShortcut> registerShortcuts(const QList<QHotkey::NativeShortcut> &shortcuts) Q_DECL_OVERRIDE;
+	QList<QHotkey::NativeShortcut> unregisterShortcuts(const QList<QHotkey::NativeShortcut> &shortcuts) Q_DECL_OVERRIDE;
+	QList<QHotkey::NativeShortcut> registerWindowShortcuts(const QList<QHotkey::NativeShortcut> &shortcuts, WId window) Q_DECL_OVERRIDE;
+	QList<QHotkey::NativeShortcut> unregisterWindowShortcuts(const QList<QHotkey::NativeShortcut> &shortcuts, WId window) Q_DECL_OVERRIDE;
+	bool setListenerThread(bool enabled) Q_DECL_OVERRIDE;
+	bool isThreadSafe() const Q_DECL_OVERRIDE;
+	quint64 keymapHash() Q_DECL_OVERRIDE;
+	QByteArray traceEventType() const Q_DECL_OVERRIDE;
+	void prepareReplay(QByteArray &message) Q_DECL_OVERRIDE;
 
 private:
-	static const QVector<quint32> specialModifiers;
-	static const quint32 validModsMask;
-	xcb_key_press_event_t prevHandledEvent;
-	xcb_key_press_event_t prevEvent;
+	// owns a private xcb connection, grabs the keys on it and reads their events on its own thread
+	class ListenerThread : public QThread
+	{
+	public:
+		explicit ListenerThread(QHotkeyPrivateX11 *hotkeyPrivate);
+		~ListenerThread() override;
 
-	static QString formatX11Error(Display *display, int errorCode);
+		bool open();
+		void stop();
 
-	class HotkeyErrorHandler {
-	public:
-		HotkeyErrorHandler();
-		~HotkeyErrorHandler();
+		xcb_connection_t *connection() const;
+		xcb_window_t rootWindow() const;
 
-		static bool hasError;
-		static QString errorString;
+	protected:
+		void run() override;
 
 	private:
-		XErrorHandler prevHandler;
-
-		static int handleError(Display *display, XErrorEvent *error);
+		QHotkeyPrivateX11 *hotkeyPrivate;
+		xcb_connection_t *xcbConnection;
+		xcb_window_t root;
+		xcb_window_t wakeWindow;
 	};
+
+	ListenerThread *listener;
+
+	static const QVector<quint32> specialModifiers;
+	static const quint32 validModsMask;
+	static const quint32 UnknownPress;
+	bool detectableAutoRepeat;
+	int xkbEventBase;
+	// the root window of Qt's screen, which is fixed for the lifetime of its connection
+	xcb_window_t qtRootWindow;
+	// a lost release, e.g. when the grab changes or the focus leaves while the key is held, would turn every later
+	// press into a repeat. Grabs change on any thread, so the keys are atomics
+	std::array<std::atomic<bool>, 256> pressedKeys;
+	// the modifiers of each key when it was pressed, used for its release. The modifiers may be let go before the key,
+	// so the release would not match the shortcut of the press otherwise.
+	// One set for the event filter and one for the listener thread, each only touched by its own thread
+	std::array<quint32, 256> pressModifiers;
+	std::array<quint32, 256> listenerPressModifiers;
+	// rebuilt lazily after each keyboard mapping change
+	QHash<KeySym, quint32> keysymToKeycode;
+	QSet<quint32> modifierKeycodes;
+	// names the rules, model, layouts and options of the keyboard, the key of the key cache
+	xcb_atom_t rulesNamesAtom;
+	QTimer keymapTimer;
+	// fallback for servers without detectable autorepeat
+	xcb_key_press_event_t prevHandledEvent;
+	xcb_key_press_event_t prevEvent;
+	xcb_key_release_event_t pendingRelease;
+	WId pendingReleaseWindow;
+	QTimer releaseTimer;
+
+	void checkPendingRelease();
+	void forgetPressedKeys(const QList<QHotkey::NativeShortcut> &shortcuts);
+	void loadKeyboardMapping();
+	void keymapChanged();
+
+	static Display *display();
+	static xcb_connection_t *connection();
+	static xcb_window_t rootWindow(xcb_connection_t *connection);
+	xcb_connection_t *grabConnection() const;
+	xcb_window_t grabRootWindow() const;
+	void handleListenerEvent(xcb_generic_event_t *event);
+	static QHotkeyEvent hotkeyEvent(const xcb_key_press_event_t &keyEvent, bool isRepeat, xcb_window_t root);
+	static WId scopeWindow(const xcb_key_press_event_t &keyEvent, xcb_window_t root);
+	static QHotkey::NativeShortcut releasedShortcut(std::array<quint32, 256> &modifiersOfPress, const xcb_key_release_event_t &keyEvent);
+	static QString formatX11Error(uint8_t errorCode);
+	QString checkCookies(xcb_connection_t *connection, const xcb_void_cookie_t *cookies, int count);
+	QList<QHotkey::NativeShortcut> grabKeys(xcb_connection_t *connection, xcb_window_t window, const QList<QHotkey::NativeShortcut> &requested);
+	QList<QHotkey::NativeShortcut> ungrabKeysChecked(xcb_connection_t *connection, xcb_window_t window, const QList<QHotkey::NativeShortcut> &shortcuts);
+	void ungrabKeys(xcb_connection_t *connection, xcb_window_t window, const QList<QHotkey::NativeShortcut> &shortcuts);
 };
-NATIVE_INSTANCE(QHotkeyPrivateX11)
+NATIVE_BACKEND(QHotkeyPrivateX11, X11)
 
-bool QHotkeyPrivate::isPlatformSupported()
+bool QHotkeyPrivateX11::isBackendSupported()
 {
 #if QT_VERSION >= QT_VERSION_CHECK(6, 2, 0)
-	return qGuiApp->nativeInterface<QNativeInterface::QX11Application>();
+	// also asked while choosing a backend for a QCoreApplication
+	return qGuiApp && qGuiApp->nativeInterface<QNativeInterface::QX11Application>();
 #else
 	return QX11Info::isPlatformX11();
 #endif
@@ -67,6 +472,64 @@ bool QHotkeyPrivate::isPlatformSupported()
 
 const QVector<quint32> QHotkeyPrivateX11::specialModifiers = {0, Mod2Mask, LockMask, (Mod2Mask | LockMask)};
 const quint32 QHotkeyPrivateX11::validModsMask = ShiftMask | ControlMask | Mod1Mask | Mod4Mask;
+const quint32 QHotkeyPrivateX11::UnknownPress = ~quint32(0);
+
+QHotkeyPrivateX11::QHotkeyPrivateX11() :
+	listener(nullptr),
+	detectableAutoRepeat(false),
+	xkbEventBase(0),
+	qtRootWindow(XCB_WINDOW_NONE),
+	rulesNamesAtom(XCB_ATOM_NONE),
+	prevHandledEvent(),
+	prevEvent(),
+	pendingRelease(),
+	pendingReleaseWindow(0)
+{
+	for(std::atomic<bool> &pressed : pressedKeys)
+		pressed.store(false, std::memory_order_relaxed);
+	pressModifiers.fill(UnknownPress);
+	listenerPressModifiers.fill(UnknownPress);
+
+	// with detectable autorepeat, holding a key only repeats the press events, so releases are always real ones.
+	// This is a one time per client flag without an xcb counterpart in libxcb itself, so it still goes through Xlib
+	Display *xDisplay = display();
+	if(xDisplay) {
+		Bool supported = False;
+		detectableAutoRepeat = XkbSetDetectableAutoRepeat(xDisplay, True, &supported) && supported;
+	}
+
+	xcb_connection_t *xcbConnection = connection();
+	if(xcbConnection) {
+		qtRootWindow = rootWindow(xcbConnection);
+
+		static const char xkbName[] = "XKEYBOARD";
+		xcb_query_extension_reply_t *reply = xcb_query_extension_reply(xcbConnection,
+																	   xcb_query_extension(xcbConnection, sizeof(xkbName) - 1, xkbName),
+																	   nullptr);
+		if(reply) {
+			if(reply->present)
+				xkbEventBase = reply->first_event;
+			free(reply);
+		}
+	}
+
+	releaseTimer.setSingleShot(true);
+	releaseTimer.setInterval(50);
+	connect(&releaseTimer, &QTimer::timeout, this, &QHotkeyPrivateX11::checkPendingRelease);
+
+	// layout changes arrive as a burst of notifications, handle them once
+	keymapTimer.setSingleShot(true);
+	keymapTimer.setInterval(0);
+	connect(&keymapTimer, &QTimer::timeout, this, &QHotkeyPrivateX11::keymapChanged);
+}
+
+QHotkeyPrivateX11::~QHotkeyPrivateX11()
+{
+	if(listener) {
+		listener->stop();
+		delete listener;
+	}
+}
 
 bool QHotkeyPrivateX11::nativeEventFilter(const QByteArray &eventType, void *message, _NATIVE_EVENT_RESULT *result)
 {
@@ -74,80 +537,213 @@ bool QHotkeyPrivateX11::nativeEventFilter(const QByteArray &eventType, void *mes
 	Q_UNUSED(result)
 
 	auto *genericEvent = static_cast<xcb_generic_event_t *>(message);
+	// scoped hotkeys are grabbed on their own window, which the event is reported for
+	const xcb_window_t root = qtRootWindow;
 	if (genericEvent->response_type == XCB_KEY_PRESS) {
 		xcb_key_press_event_t keyEvent = *static_cast<xcb_key_press_event_t *>(message);
-		this->prevEvent = keyEvent;
-		if (this->prevHandledEvent.response_type == XCB_KEY_RELEASE) {
-			if(this->prevHandledEvent.time == keyEvent.time) return false;
+		// keys typed into the windows of this application are neither traced nor dispatched, unless they are grabbed
+		if(!hasListeners({keyEvent.detail, keyEvent.state & QHotkeyPrivateX11::validModsMask}, scopeWindow(keyEvent, root)))
+			return false;
+		traceEvent(message, TracedEventSize);
+		if(detectableAutoRepeat) {
+			if(pressedKeys[keyEvent.detail].exchange(true, std::memory_order_relaxed)) {
+				this->repeatShortcut(hotkeyEvent(keyEvent, true, root));
+				return false;
+			}
+		} else {
+			this->prevEvent = keyEvent;
+			if (this->prevHandledEvent.response_type == XCB_KEY_RELEASE) {
+				if(this->prevHandledEvent.time == keyEvent.time) {
+					this->repeatShortcut(hotkeyEvent(keyEvent, true, root));
+					return false;
+				}
+			}
 		}
-		this->activateShortcut({keyEvent.detail, keyEvent.state & QHotkeyPrivateX11::validModsMask});
+		pressModifiers[keyEvent.detail] = keyEvent.state & QHotkeyPrivateX11::validModsMask;
+		this->activateShortcut(hotkeyEvent(keyEvent, false, root));
 	} else if (genericEvent->response_type == XCB_KEY_RELEASE) {
 		xcb_key_release_event_t keyEvent = *static_cast<xcb_key_release_event_t *>(message);
-		this->prevEvent = keyEvent;
-		QTimer::singleShot(50, [this, keyEvent] {
-			if(this->prevEvent.time == keyEvent.time && this->prevEvent.response_type == keyEvent.response_type && this->prevEvent.detail == keyEvent.detail){
-				this->releaseShortcut({keyEvent.detail, keyEvent.state & QHotkeyPrivateX11::validModsMask});
-			}
-		});
-		this->prevHandledEvent = keyEvent;
+		// the same for releases, only the presses that were handled have their modifiers recorded
+		if(scopeWindow(keyEvent, root) != 0 && pressModifiers[keyEvent.detail] == UnknownPress)
+			return false;
+		traceEvent(message, TracedEventSize);
+		if(detectableAutoRepeat) {
+			pressedKeys[keyEvent.detail].store(false, std::memory_order_relaxed);
+			this->releaseShortcut(releasedShortcut(pressModifiers, keyEvent), scopeWindow(keyEvent, root));
+		} else {
+			// an autorepeat press with the same timestamp may follow, so wait for it before releasing
+			this->prevEvent = keyEvent;
+			this->pendingRelease = keyEvent;
+			this->pendingReleaseWindow = scopeWindow(keyEvent, root);
+			this->prevHandledEvent = keyEvent;
+			releaseTimer.start();
+		}
+	} else if ((genericEvent->response_type & ~0x80) == XCB_FOCUS_OUT) {
+		traceEvent(message, TracedEventSize);
+		// the releases of keys held while a window of this application loses the focus go elsewhere. Changes
+		// during a grab of this client are reported as while grabbed and keep their releases
+		const uint8_t mode = static_cast<xcb_focus_out_event_t *>(message)->mode;
+		if(mode == XCB_NOTIFY_MODE_NORMAL || mode == XCB_NOTIFY_MODE_GRAB) {
+			for(std::atomic<bool> &pressed : pressedKeys)
+				pressed.store(false, std::memory_order_relaxed);
+		}
+	} else if ((genericEvent->response_type & ~0x80) == XCB_MAPPING_NOTIFY) {
+		traceEvent(message, TracedEventSize);
+		auto *mappingEvent = static_cast<xcb_mapping_notify_event_t *>(message);
+		if(mappingEvent->request == XCB_MAPPING_KEYBOARD)
+			keymapTimer.start();
+	} else if (xkbEventBase != 0 && genericEvent->response_type == xkbEventBase) {
+		traceEvent(message, TracedEventSize);
+		// the second byte of every XKB event holds its XKB event type
+		if(genericEvent->pad0 == XkbNewKeyboardNotify || genericEvent->pad0 == XkbMapNotify)
+			keymapTimer.start();
 	}
 
 	return false;
 }
 
-QString QHotkeyPrivateX11::getX11String(Qt::Key keycode)
-{
-	switch(keycode){
-
-		case Qt::Key_MediaLast :
-		case Qt::Key_MediaPrevious :
-			return QStringLiteral("XF86AudioPrev");
-		case Qt::Key_MediaNext :
-			return QStringLiteral("XF86AudioNext");
-		case Qt::Key_MediaPause :
-		case Qt::Key_MediaPlay :
-		case Qt::Key_MediaTogglePlayPause :
-			return QStringLiteral("XF86AudioPlay");
-		case Qt::Key_MediaRecord :
-			return QStringLiteral("XF86AudioRecord");
-		case Qt::Key_MediaStop :
-			return QStringLiteral("XF86AudioStop");
-		default :
-			return QKeySequence(keycode).toString(QKeySequence::NativeText);
+void QHotkeyPrivateX11::checkPendingRelease()
+{
+	if(this->prevEvent.time == pendingRelease.time &&
+	   this->prevEvent.response_type == pendingRelease.response_type &&
+	   this->prevEvent.detail == pendingRelease.detail) {
+		this->releaseShortcut(releasedShortcut(pressModifiers, pendingRelease), pendingReleaseWindow);
 	}
 }
 
-quint32 QHotkeyPrivateX11::nativeKeycode(Qt::Key keycode, bool &ok)
+void QHotkeyPrivateX11::forgetPressedKeys(const QList<QHotkey::NativeShortcut> &shortcuts)
 {
-	QString keyString = getX11String(keycode);
+	// the release of a key held while its grab changes may never arrive
+	for(QHotkey::NativeShortcut shortcut : shortcuts)
+		pressedKeys[shortcut.key & 0xFF].store(false, std::memory_order_relaxed);
+}
 
-	KeySym keysym = XStringToKeysym(keyString.toLatin1().constData());
-	if (keysym == NoSymbol) {
-		//not found -> just use the key
-		if(keycode <= 0xFFFF)
-			keysym = keycode;
-		else
+void QHotkeyPrivateX11::loadKeyboardMapping()
+{
+	keysymToKeycode.clear();
+	modifierKeycodes.clear();
+
+	xcb_connection_t *xcbConnection = connection();
+	if(!xcbConnection)
+		return;
+
+	const xcb_setup_t *setup = xcb_get_setup(xcbConnection);
+	const int minKeycode = setup->min_keycode;
+	const int maxKeycode = setup->max_keycode;
+	xcb_get_keyboard_mapping_reply_t *reply = xcb_get_keyboard_mapping_reply(xcbConnection,
+																			 xcb_get_keyboard_mapping(xcbConnection,
+																									  setup->min_keycode,
+																									  static_cast<uint8_t>(maxKeycode - minKeycode + 1)),
+																			 nullptr);
+	if(!reply)
+		return;
+
+	const int keysymsPerKeycode = reply->keysyms_per_keycode;
+	const xcb_keysym_t *keysyms = xcb_get_keyboard_mapping_keysyms(reply);
+	// same search order as XKeysymToKeycode: all keycodes of the first column win over later columns
+	for(int column = 0; column < keysymsPerKeycode; ++column) {
+		for(int keycode = minKeycode; keycode <= maxKeycode; ++keycode) {
+			const xcb_keysym_t *row = keysyms + (keycode - minKeycode) * keysymsPerKeycode;
+			KeySym keysym = row[column];
+			if(column == 1 && keysym == NoSymbol) {
+				KeySym lower = NoSymbol;
+				XConvertCase(row[0], &lower, &keysym);
+			}
+			if(keysym != NoSymbol && !keysymToKeycode.contains(keysym))
+				keysymToKeycode.insert(keysym, static_cast<quint32>(keycode));
+		}
+	}
+	free(reply);
+
+	xcb_get_modifier_mapping_reply_t *modifierReply = xcb_get_modifier_mapping_reply(xcbConnection,
+																					 xcb_get_modifier_mapping(xcbConnection),
+																					 nullptr);
+	if(!modifierReply)
+		return;
+	const xcb_keycode_t *modifierKeys = xcb_get_modifier_mapping_keycodes(modifierReply);
+	const int modifierKeyCount = xcb_get_modifier_mapping_keycodes_length(modifierReply);
+	for(int i = 0; i < modifierKeyCount; ++i) {
+		if(modifierKeys[i] != 0)
+			modifierKeycodes.insert(modifierKeys[i]);
+	}
+	free(modifierReply);
+}
+
+quint64 QHotkeyPrivateX11::keymapHash()
+{
+	// the keyboard mapping itself is only loaded for keys the cache misses, so the key comes from the names of the
+	// layout the XKB server set up, which is a single round trip
+	xcb_connection_t *xcbConnection = connection();
+	if(!xcbConnection)
+		return 0;
+
+	if(rulesNamesAtom == XCB_ATOM_NONE) {
+		static const char RulesNames[] = "_XKB_RULES_NAMES";
+		xcb_intern_atom_reply_t *atomReply = xcb_intern_atom_reply(xcbConnection,
+																   xcb_intern_atom(xcbConnection, 1, sizeof(RulesNames) - 1, RulesNames),
+																   nullptr);
+		if(!atomReply)
+			return 0;
+		rulesNamesAtom = atomReply->atom;
+		free(atomReply);
+		if(rulesNamesAtom == XCB_ATOM_NONE)
 			return 0;
 	}
 
-#if QT_VERSION >= QT_VERSION_CHECK(6, 2, 0)
-	const QNativeInterface::QX11Application *x11Interface = qGuiApp->nativeInterface<QNativeInterface::QX11Application>();
-#else
-	const bool x11Interface = QX11Info::isPlatformX11();
-#endif
+	xcb_get_property_reply_t *reply = xcb_get_property_reply(xcbConnection,
+															 xcb_get_property(xcbConnection, 0, qtRootWindow,
+																			  rulesNamesAtom, XCB_ATOM_STRING, 0, 1024),
+															 nullptr);
+	if(!reply)
+		return 0;
+	const int length = xcb_get_property_value_length(reply);
+	if(reply->type != XCB_ATOM_STRING || length == 0) {
+		free(reply);
+		return 0;
+	}
 
-	if(x11Interface) {
-#if QT_VERSION >= QT_VERSION_CHECK(6, 2, 0)
-		Display *display = x11Interface->display();
-#else
-		Display *display = QX11Info::display();
-#endif
-		auto res = XKeysymToKeycode(display, keysym);
-		if(res != 0)
-			ok = true;
-		return res;
+	// FNV-1a over the names and the keycode range, identifies the layout for all processes on this display
+	quint64 hash = Q_UINT64_C(0xcbf29ce484222325);
+	const auto hashByte = [&hash](quint8 value) {
+		hash ^= value;
+		hash *= Q_UINT64_C(0x100000001b3);
+	};
+	const xcb_setup_t *setup = xcb_get_setup(xcbConnection);
+	hashByte(setup->min_keycode);
+	hashByte(setup->max_keycode);
+	const auto names = static_cast<const quint8*>(xcb_get_property_value(reply));
+	for(int i = 0; i < length; ++i)
+		hashByte(names[i]);
+	free(reply);
+	return hash;
+}
+
+void QHotkeyPrivateX11::keymapChanged()
+{
+	// translations on other threads read the mapping
+	RegistryWriteLocker locker(this);
+	keysymToKeycode.clear();
+	remapShortcuts();
+}
+
+quint32 QHotkeyPrivateX11::nativeKeycode(Qt::Key keycode, bool &ok)
+{
+	const KeySym keysym = qtKeyToKeysym(keycode);
+	if(keysym == NoSymbol)
+		return 0;
+
+	if(keysymToKeycode.isEmpty())
+		loadKeyboardMapping();
+
+	quint32 res = keysymToKeycode.value(keysym, 0);
+	if(res == 0) {
+		const KeySym legacy = legacyKeysym(keycode);
+		if(legacy != NoSymbol)
+			res = keysymToKeycode.value(legacy, 0);
 	}
-	return 0;
+	if(res != 0)
+		ok = true;
+	return res;
 }
 
 quint32 QHotkeyPrivateX11::nativeModifiers(Qt::KeyboardModifiers modifiers, bool &ok)
@@ -166,106 +762,430 @@ quint32 QHotkeyPrivateX11::nativeModifiers(Qt::KeyboardModifiers modifiers, bool
 }
 
 bool QHotkeyPrivateX11::registerShortcut(QHotkey::NativeShortcut shortcut)
+{
+	return registerShortcuts({shortcut}).isEmpty();
+}
+
+bool QHotkeyPrivateX11::unregisterShortcut(QHotkey::NativeShortcut shortcut)
+{
+	return unregisterShortcuts({shortcut}).isEmpty();
+}
+
+QList<QHotkey::NativeShortcut> QHotkeyPrivateX11::registerShortcuts(const QList<QHotkey::NativeShortcut> &shortcuts)
+{
+	xcb_connection_t *xcbConnection = grabConnection();
+	if(!xcbConnection)
+		return shortcuts;
+	return grabKeys(xcbConnection, grabRootWindow(), shortcuts);
+}
+
+QList<QHotkey::NativeShortcut> QHotkeyPrivateX11::unregisterShortcuts(const QList<QHotkey::NativeShortcut> &shortcuts)
+{
+	xcb_connection_t *xcbConnection = grabConnection();
+	if(!xcbConnection)
+		return shortcuts;
+	return ungrabKeysChecked(xcbConnection, grabRootWindow(), shortcuts);
+}
+
+QList<QHotkey::NativeShortcut> QHotkeyPrivateX11::registerWindowShortcuts(const QList<QHotkey::NativeShortcut> &shortcuts, WId window)
+{
+	xcb_connection_t *xcbConnection = grabConnection();
+	if(!xcbConnection)
+		return shortcuts;
+	return grabKeys(xcbConnection, static_cast<xcb_window_t>(window), shortcuts);
+}
+
+QList<QHotkey::NativeShortcut> QHotkeyPrivateX11::unregisterWindowShortcuts(const QList<QHotkey::NativeShortcut> &shortcuts, WId window)
+{
+	xcb_connection_t *xcbConnection = grabConnection();
+	if(!xcbConnection)
+		return shortcuts;
+	return ungrabKeysChecked(xcbConnection, static_cast<xcb_window_t>(window), shortcuts);
+}
+
+QList<QHotkey::NativeShortcut> QHotkeyPrivateX11::grabKeys(xcb_connection_t *connection, xcb_window_t window, const QList<QHotkey::NativeShortcut> &requested)
+{
+	// a passive grab of a modifier key turns into a grab of the whole keyboard while it is held, so Ctrl+C and any
+	// other shortcut typed with it would never reach the focused application. Those are refused instead
+	if(keysymToKeycode.isEmpty())
+		loadKeyboardMapping();
+	QList<QHotkey::NativeShortcut> failed;
+	QList<QHotkey::NativeShortcut> shortcuts;
+	shortcuts.reserve(requested.size());
+	for(QHotkey::NativeShortcut shortcut : requested) {
+		if(modifierKeycodes.contains(shortcut.key)) {
+			error = QStringLiteral("Modifier keys cannot be grabbed on X11 without grabbing the whole keyboard");
+			failed.append(shortcut);
+		} else
+			shortcuts.append(shortcut);
+	}
+	if(shortcuts.isEmpty())
+		return failed;
+
+	forgetPressedKeys(shortcuts);
+
+	// pipeline all grabs, the first check then waits for a single round-trip that answers all of them
+	const int grabsPerShortcut = QHotkeyPrivateX11::specialModifiers.size();
+	QVector<xcb_void_cookie_t> cookies;
+	cookies.reserve(shortcuts.size() * grabsPerShortcut);
+	for(QHotkey::NativeShortcut shortcut : shortcuts) {
+		for(quint32 specialMod : QHotkeyPrivateX11::specialModifiers) {
+			cookies.append(xcb_grab_key_checked(connection,
+												1,
+												window,
+												static_cast<uint16_t>(shortcut.modifier | specialMod),
+												static_cast<xcb_keycode_t>(shortcut.key),
+												XCB_GRAB_MODE_ASYNC,
+												XCB_GRAB_MODE_ASYNC));
+		}
+	}
+
+	QList<QHotkey::NativeShortcut> failedGrabs;
+	for(int i = 0; i < shortcuts.size(); ++i) {
+		const QString errorString = checkCookies(connection, cookies.constData() + i * grabsPerShortcut, grabsPerShortcut);
+		if(!errorString.isNull()) {
+			error = errorString;
+			failedGrabs.append(shortcuts[i]);
+		}
+	}
+
+	// release the partial grabs of the failed shortcuts
+	if(!failedGrabs.isEmpty())
+		ungrabKeys(connection, window, failedGrabs);
+	return failed + failedGrabs;
+}
+
+QList<QHotkey::NativeShortcut> QHotkeyPrivateX11::ungrabKeysChecked(xcb_connection_t *connection, xcb_window_t window, const QList<QHotkey::NativeShortcut> &shortcuts)
+{
+	forgetPressedKeys(shortcuts);
+
+	// same pipelining as for the grabs
+	const int grabsPerShortcut = QHotkeyPrivateX11::specialModifiers.size();
+	QVector<xcb_void_cookie_t> cookies;
+	cookies.reserve(shortcuts.size() * grabsPerShortcut);
+	for(QHotkey::NativeShortcut shortcut : shortcuts) {
+		for(quint32 specialMod : QHotkeyPrivateX11::specialModifiers) {
+			cookies.append(xcb_ungrab_key_checked(connection,
+												  static_cast<xcb_keycode_t>(shortcut.key),
+												  window,
+												  static_cast<uint16_t>(shortcut.modifier | specialMod)));
+		}
+	}
+
+	QList<QHotkey::NativeShortcut> failed;
+	for(int i = 0; i < shortcuts.size(); ++i) {
+		const QString errorString = checkCookies(connection, cookies.constData() + i * grabsPerShortcut, grabsPerShortcut);
+		if(!errorString.isNull()) {
+			error = errorString;
+			failed.append(shortcuts[i]);
+		}
+	}
+	return failed;
+}
+
+Display *QHotkeyPrivateX11::display()
 {
 #if QT_VERSION >= QT_VERSION_CHECK(6, 2, 0)
 	const QNativeInterface::QX11Application *x11Interface = qGuiApp->nativeInterface<QNativeInterface::QX11Application>();
-	Display *display = x11Interface->display();
+	return x11Interface ? x11Interface->display() : nullptr;
 #else
-	const bool x11Interface = QX11Info::isPlatformX11();
-	Display *display = QX11Info::display();
+	return QX11Info::isPlatformX11() ? QX11Info::display() : nullptr;
 #endif
+}
 
-	if(!display || !x11Interface)
-		return false;
+xcb_connection_t *QHotkeyPrivateX11::connection()
+{
+#if QT_VERSION >= QT_VERSION_CHECK(6, 2, 0)
+	const QNativeInterface::QX11Application *x11Interface = qGuiApp->nativeInterface<QNativeInterface::QX11Application>();
+	return x11Interface ? x11Interface->connection() : nullptr;
+#else
+	return QX11Info::isPlatformX11() ? QX11Info::connection() : nullptr;
+#endif
+}
 
-	HotkeyErrorHandler errorHandler;
-	for(quint32 specialMod : QHotkeyPrivateX11::specialModifiers) {
-		XGrabKey(display,
-				 shortcut.key,
-				 shortcut.modifier | specialMod,
-				 DefaultRootWindow(display),
-				 True,
-				 GrabModeAsync,
-				 GrabModeAsync);
-	}
-	XSync(display, False);
+xcb_window_t QHotkeyPrivateX11::rootWindow(xcb_connection_t *connection)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(6, 2, 0)
+	return xcb_setup_roots_iterator(xcb_get_setup(connection)).data->root;
+#else
+	Q_UNUSED(connection)
+	return static_cast<xcb_window_t>(QX11Info::appRootWindow());
+#endif
+}
 
-	if(errorHandler.hasError) {
-		error = errorHandler.errorString;
-		this->unregisterShortcut(shortcut);
-		return false;
+xcb_connection_t *QHotkeyPrivateX11::grabConnection() const
+{
+	return listener ? listener->connection() : connection();
+}
+
+xcb_window_t QHotkeyPrivateX11::grabRootWindow() const
+{
+	return listener ? listener->rootWindow() : qtRootWindow;
+}
+
+bool QHotkeyPrivateX11::setListenerThread(bool enabled)
+{
+	if(enabled == (listener != nullptr))
+		return true;
+
+	if(enabled) {
+		auto thread = new ListenerThread(this);
+		if(!thread->open()) {
+			delete thread;
+			error = QStringLiteral("Unable to open a separate connection to the X server with detectable autorepeat");
+			return false;
+		}
+		listener = thread;
+		listener->start();
+	} else {
+		listener->stop();
+		delete listener;
+		listener = nullptr;
 	}
 	return true;
 }
 
-bool QHotkeyPrivateX11::unregisterShortcut(QHotkey::NativeShortcut shortcut)
+bool QHotkeyPrivateX11::isThreadSafe() const
 {
-#if QT_VERSION >= QT_VERSION_CHECK(6, 2, 0)
-	Display *display = qGuiApp->nativeInterface<QNativeInterface::QX11Application>()->display();
-#else
-	Display *display = QX11Info::display();
-#endif
+	// xcb connections may be used from any thread. The keysym table is rebuilt lazily, which is safe because all
+	// translations and the rebuild run under the registry write lock
+	return true;
+}
 
-	if(!display)
-		return false;
+QByteArray QHotkeyPrivateX11::traceEventType() const
+{
+	return QByteArrayLiteral("xcb_generic_event_t");
+}
+
+void QHotkeyPrivateX11::prepareReplay(QByteArray &message)
+{
+	if(message.size() < static_cast<int>(sizeof(xcb_generic_event_t)))
+		message.append(static_cast<int>(sizeof(xcb_generic_event_t)) - message.size(), '\0');
 
-	HotkeyErrorHandler errorHandler;
-	for(quint32 specialMod : QHotkeyPrivateX11::specialModifiers) {
-		XUngrabKey(display,
-				   shortcut.key,
-				   shortcut.modifier | specialMod,
-				   XDefaultRootWindow(display));
+	// global grabs are recognized by their root window, which differs between sessions
+	auto *genericEvent = reinterpret_cast<xcb_generic_event_t *>(message.data());
+	if(genericEvent->response_type == XCB_KEY_PRESS || genericEvent->response_type == XCB_KEY_RELEASE) {
+		auto *keyEvent = reinterpret_cast<xcb_key_press_event_t *>(message.data());
+		if(keyEvent->event == keyEvent->root)
+			keyEvent->event = qtRootWindow;
+		keyEvent->root = qtRootWindow;
 	}
-	XSync(display, False);
+}
 
-	if(HotkeyErrorHandler::hasError) {
-		error = HotkeyErrorHandler::errorString;
-		return false;
+void QHotkeyPrivateX11::handleListenerEvent(xcb_generic_event_t *event)
+{
+	// same as the event filter, synthetic key events are ignored. The connection always has detectable autorepeat
+	const xcb_window_t root = listener->rootWindow();
+	if(event->response_type == XCB_KEY_PRESS) {
+		auto *keyEvent = reinterpret_cast<xcb_key_press_event_t *>(event);
+		if(pressedKeys[keyEvent->detail].exchange(true, std::memory_order_relaxed))
+			repeatShortcut(hotkeyEvent(*keyEvent, true, root));
+		else {
+			listenerPressModifiers[keyEvent->detail] = keyEvent->state & QHotkeyPrivateX11::validModsMask;
+			activateShortcut(hotkeyEvent(*keyEvent, false, root));
+		}
+	} else if(event->response_type == XCB_KEY_RELEASE) {
+		auto *keyEvent = reinterpret_cast<xcb_key_release_event_t *>(event);
+		pressedKeys[keyEvent->detail].store(false, std::memory_order_relaxed);
+		releaseShortcut(releasedShortcut(listenerPressModifiers, *keyEvent), scopeWindow(*keyEvent, root));
 	}
-	return true;
 }
 
-QString QHotkeyPrivateX11::formatX11Error(Display *display, int errorCode)
+QHotkeyEvent QHotkeyPrivateX11::hotkeyEvent(const xcb_key_press_event_t &keyEvent, bool isRepeat, xcb_window_t root)
 {
-	char errStr[256];
-	XGetErrorText(display, errorCode, errStr, 256);
-	return QString::fromLatin1(errStr);
+	return QHotkeyEvent({keyEvent.detail, keyEvent.state & QHotkeyPrivateX11::validModsMask},
+						keyEvent.detail,
+						keyEvent.state,
+						keyEvent.time,
+						QHotkeyEvent::currentNsecs(),
+						isRepeat,
+						scopeWindow(keyEvent, root));
 }
 
+WId QHotkeyPrivateX11::scopeWindow(const xcb_key_press_event_t &keyEvent, xcb_window_t root)
+{
+	// passive grabs report the window they were made on, global ones the root window
+	return keyEvent.event == root ? 0 : static_cast<WId>(keyEvent.event);
+}
 
+QHotkey::NativeShortcut QHotkeyPrivateX11::releasedShortcut(std::array<quint32, 256> &modifiersOfPress, const xcb_key_release_event_t &keyEvent)
+{
+	// keys pressed before the grab have no recorded press
+	quint32 modifiers = modifiersOfPress[keyEvent.detail];
+	if(modifiers == UnknownPress)
+		modifiers = keyEvent.state & QHotkeyPrivateX11::validModsMask;
+	modifiersOfPress[keyEvent.detail] = UnknownPress;
+	return {keyEvent.detail, modifiers};
+}
 
-// ---------- QHotkeyPrivateX11::HotkeyErrorHandler implementation ----------
+QString QHotkeyPrivateX11::formatX11Error(uint8_t errorCode)
+{
+	switch (errorCode) {
+	case XCB_ACCESS:
+		return QStringLiteral("BadAccess (attempt to access private resource denied)");
+	case XCB_VALUE:
+		return QStringLiteral("BadValue (integer parameter out of range for operation)");
+	case XCB_WINDOW:
+		return QStringLiteral("BadWindow (invalid Window parameter)");
+	default:
+		return QStringLiteral("X11 error %1").arg(errorCode);
+	}
+}
+
+QString QHotkeyPrivateX11::checkCookies(xcb_connection_t *connection, const xcb_void_cookie_t *cookies, int count)
+{
+	// every cookie has to be checked, otherwise its error would stay queued in the connection
+	QString errorString;
+	for(int i = 0; i < count; ++i) {
+		xcb_generic_error_t *xcbError = xcb_request_check(connection, cookies[i]);
+		if(xcbError) {
+			if(errorString.isNull())
+				errorString = formatX11Error(xcbError->error_code);
+			free(xcbError);
+		}
+	}
+	return errorString;
+}
+
+void QHotkeyPrivateX11::ungrabKeys(xcb_connection_t *connection, xcb_window_t window, const QList<QHotkey::NativeShortcut> &shortcuts)
+{
+	for(QHotkey::NativeShortcut shortcut : shortcuts) {
+		for(quint32 specialMod : QHotkeyPrivateX11::specialModifiers) {
+			const xcb_void_cookie_t cookie = xcb_ungrab_key_checked(connection,
+																	static_cast<xcb_keycode_t>(shortcut.key),
+																	window,
+																	static_cast<uint16_t>(shortcut.modifier | specialMod));
+			xcb_discard_reply(connection, cookie.sequence);
+		}
+	}
+	xcb_flush(connection);
+}
 
-bool QHotkeyPrivateX11::HotkeyErrorHandler::hasError = false;
-QString QHotkeyPrivateX11::HotkeyErrorHandler::errorString;
 
-QHotkeyPrivateX11::HotkeyErrorHandler::HotkeyErrorHandler()
+
+// ---------- QHotkeyPrivateX11::ListenerThread implementation ----------
+
+QHotkeyPrivateX11::ListenerThread::ListenerThread(QHotkeyPrivateX11 *hotkeyPrivate) :
+	QThread(),
+	hotkeyPrivate(hotkeyPrivate),
+	xcbConnection(nullptr),
+	root(XCB_WINDOW_NONE),
+	wakeWindow(XCB_WINDOW_NONE)
 {
-	prevHandler = XSetErrorHandler(&HotkeyErrorHandler::handleError);
+	setObjectName(QStringLiteral("QHotkeyListener"));
 }
 
-QHotkeyPrivateX11::HotkeyErrorHandler::~HotkeyErrorHandler()
+QHotkeyPrivateX11::ListenerThread::~ListenerThread()
 {
-	XSetErrorHandler(prevHandler);
-	hasError = false;
-	errorString.clear();
+	if(xcbConnection)
+		xcb_disconnect(xcbConnection);
 }
 
-int QHotkeyPrivateX11::HotkeyErrorHandler::handleError(Display *display, XErrorEvent *error)
+bool QHotkeyPrivateX11::ListenerThread::open()
 {
-	switch (error->error_code) {
-	case BadAccess:
-	case BadValue:
-	case BadWindow:
-		if (error->request_code == 33 || //grab key
-			error->request_code == 34) {// ungrab key
-			hasError = true;
-			errorString = QHotkeyPrivateX11::formatX11Error(display, error->error_code);
-			return 1;
+	// the display of Qt, which was not necessarily chosen by $DISPLAY, e.g. with the -display argument
+	Display *qtDisplay = QHotkeyPrivateX11::display();
+	xcb_connection_t *qtConnection = QHotkeyPrivateX11::connection();
+	if(!qtDisplay || !qtConnection)
+		return false;
+
+	xcbConnection = xcb_connect(DisplayString(qtDisplay), nullptr);
+	if(xcb_connection_has_error(xcbConnection)) {
+		xcb_disconnect(xcbConnection);
+		xcbConnection = nullptr;
+		return false;
+	}
+
+	// detectable autorepeat is a flag of each client, so it is enabled for this connection as well. Without it, the
+	// releases of held keys cannot be told apart from real ones
+	xcb_xkb_use_extension_reply_t *xkbReply = xcb_xkb_use_extension_reply(xcbConnection,
+																		  xcb_xkb_use_extension(xcbConnection,
+																								XCB_XKB_MAJOR_VERSION,
+																								XCB_XKB_MINOR_VERSION),
+																		  nullptr);
+	const bool hasXkb = xkbReply && xkbReply->supported;
+	free(xkbReply);
+	xcb_xkb_per_client_flags_reply_t *flagsReply = nullptr;
+	if(hasXkb) {
+		flagsReply = xcb_xkb_per_client_flags_reply(xcbConnection,
+													xcb_xkb_per_client_flags(xcbConnection,
+																			 XCB_XKB_ID_USE_CORE_KBD,
+																			 XCB_XKB_PER_CLIENT_FLAG_DETECTABLE_AUTO_REPEAT,
+																			 XCB_XKB_PER_CLIENT_FLAG_DETECTABLE_AUTO_REPEAT,
+																			 0, 0, 0),
+													nullptr);
+	}
+	const bool detectable = flagsReply && (flagsReply->value & XCB_XKB_PER_CLIENT_FLAG_DETECTABLE_AUTO_REPEAT);
+	free(flagsReply);
+	if(!detectable) {
+		xcb_disconnect(xcbConnection);
+		xcbConnection = nullptr;
+		return false;
+	}
+
+	// window ids are the same on every connection to the server, so the grabs go to the root window of Qt's screen
+	root = hotkeyPrivate->qtRootWindow;
+
+	// an invisible window, only used to wake up the thread when it should stop
+	wakeWindow = xcb_generate_id(xcbConnection);
+	xcb_create_window(xcbConnection,
+					  XCB_COPY_FROM_PARENT,
+					  wakeWindow,
+					  root,
+					  0, 0, 1, 1, 0,
+					  XCB_WINDOW_CLASS_INPUT_ONLY,
+					  XCB_COPY_FROM_PARENT,
+					  0,
+					  nullptr);
+	xcb_flush(xcbConnection);
+	return true;
+}
+
+void QHotkeyPrivateX11::ListenerThread::stop()
+{
+	requestInterruption();
+
+	xcb_client_message_event_t event = {};
+	event.response_type = XCB_CLIENT_MESSAGE;
+	event.format = 32;
+	event.window = wakeWindow;
+	event.type = XCB_ATOM_NONE;
+	xcb_send_event(xcbConnection, 0, wakeWindow, XCB_EVENT_MASK_NO_EVENT, reinterpret_cast<const char *>(&event));
+	xcb_flush(xcbConnection);
+	wait();
+
+	xcb_destroy_window(xcbConnection, wakeWindow);
+	xcb_flush(xcbConnection);
+}
+
+xcb_connection_t *QHotkeyPrivateX11::ListenerThread::connection() const
+{
+	return xcbConnection;
+}
+
+xcb_window_t QHotkeyPrivateX11::ListenerThread::rootWindow() const
+{
+	return root;
+}
+
+void QHotkeyPrivateX11::ListenerThread::run()
+{
+	while(true) {
+		xcb_generic_event_t *event = xcb_wait_for_event(xcbConnection);
+		if(!event)
+			break;
+
+		const uint8_t type = event->response_type & ~0x80;
+		if(type == XCB_CLIENT_MESSAGE &&
+		   reinterpret_cast<xcb_client_message_event_t *>(event)->window == wakeWindow) {
+			free(event);
+			if(isInterruptionRequested())
+				break;
+			continue;
 		}
-		Q_FALLTHROUGH();
-		// fall through
-	default:
-		return 0;
+
+		hotkeyPrivate->traceEvent(event, TracedEventSize);
+		hotkeyPrivate->handleListenerEvent(event);
+		free(event);
 	}
 }
@@ -0,0 +1,148 @@
+#include "qhotkeyprofile.h"
+#include <QSettings>
+#include <QDebug>
+
+QHotkeyProfile::QHotkeyProfile(QObject *parent) :
+	QObject(parent)
+{}
+
+QHotkeyProfile::~QHotkeyProfile()
+{
+	QHotkey::unregisterAll(_hotkeys.values());
+}
+
+QHash<QString, QKeySequence> QHotkeyProfile::bindings() const
+{
+	return _bindings;
+}
+
+QHotkey *QHotkeyProfile::hotkey(const QString &action) const
+{
+	return _hotkeys.value(action);
+}
+
+QStringList QHotkeyProfile::failedActions() const
+{
+	QStringList actions;
+	for(auto it = _bindings.constBegin(); it != _bindings.constEnd(); ++it) {
+		QHotkey *hotkey = _hotkeys.value(it.key());
+		if(!hotkey || !hotkey->isRegistered())
+			actions.append(it.key());
+	}
+	return actions;
+}
+
+QJsonObject QHotkeyProfile::toJson() const
+{
+	QJsonObject object;
+	for(auto it = _bindings.constBegin(); it != _bindings.constEnd(); ++it)
+		object.insert(it.key(), it.value().toString(QKeySequence::PortableText));
+	return object;
+}
+
+void QHotkeyProfile::saveSettings(QSettings *settings) const
+{
+	for(const QString &key : settings->childKeys()) {
+		if(!_bindings.contains(key))
+			settings->remove(key);
+	}
+	for(auto it = _bindings.constBegin(); it != _bindings.constEnd(); ++it)
+		settings->setValue(it.key(), it.value().toString(QKeySequence::PortableText));
+}
+
+bool QHotkeyProfile::setBindings(const QHash<QString, QKeySequence> &bindings)
+{
+	QHash<QString, QHotkey*> hotkeys;
+	QList<QHotkey*> added;
+	QList<QHotkey*> obsolete;
+	bool ok = true;
+	for(auto it = bindings.constBegin(); it != bindings.constEnd(); ++it) {
+		QHotkey *current = _hotkeys.value(it.key());
+		if(current && _bindings.value(it.key()) == it.value()) {
+			hotkeys.insert(it.key(), current);
+			if(!current->isRegistered())
+				added.append(current);
+			continue;
+		}
+
+		if(current)
+			obsolete.append(current);
+		QHotkey *hotkey = createHotkey(it.key(), it.value());
+		if(hotkey) {
+			hotkeys.insert(it.key(), hotkey);
+			added.append(hotkey);
+		} else
+			ok = false;
+	}
+	for(auto it = _hotkeys.constBegin(); it != _hotkeys.constEnd(); ++it) {
+		if(!bindings.contains(it.key()))
+			obsolete.append(it.value());
+	}
+
+	// grab the new keys before releasing the old ones, so keys that only moved to a different action stay grabbed
+	if(!QHotkey::registerAll(added).isEmpty())
+		ok = false;
+	QHotkey::unregisterAll(obsolete);
+	qDeleteAll(obsolete);
+
+	_bindings = bindings;
+	_hotkeys = hotkeys;
+	return ok;
+}
+
+void QHotkeyProfile::clear()
+{
+	setBindings({});
+}
+
+bool QHotkeyProfile::loadJson(const QJsonObject &object)
+{
+	QHash<QString, QKeySequence> bindings;
+	bool ok = true;
+	for(auto it = object.constBegin(); it != object.constEnd(); ++it) {
+		const QString value = it.value().toString();
+		const QKeySequence sequence = QKeySequence::fromString(value, QKeySequence::PortableText);
+		if(sequence.isEmpty()) {
+			qCWarning(logQHotkey) << "Ignoring invalid key sequence" << value << "of action" << it.key();
+			ok = false;
+			continue;
+		}
+		bindings.insert(it.key(), sequence);
+	}
+	return setBindings(bindings) && ok;
+}
+
+bool QHotkeyProfile::loadSettings(QSettings *settings)
+{
+	QHash<QString, QKeySequence> bindings;
+	bool ok = true;
+	for(const QString &key : settings->childKeys()) {
+		const QString value = settings->value(key).toString();
+		const QKeySequence sequence = QKeySequence::fromString(value, QKeySequence::PortableText);
+		if(sequence.isEmpty()) {
+			qCWarning(logQHotkey) << "Ignoring invalid key sequence" << value << "of action" << key;
+			ok = false;
+			continue;
+		}
+		bindings.insert(key, sequence);
+	}
+	return setBindings(bindings) && ok;
+}
+
+QHotkey *QHotkeyProfile::createHotkey(const QString &action, const QKeySequence &sequence)
+{
+	auto hotkey = new QHotkey(this);
+	if(!hotkey->setShortcut(sequence, false)) {
+		qCWarning(logQHotkey) << "Unable to create the hotkey of action" << action;
+		delete hotkey;
+		return nullptr;
+	}
+
+	connect(hotkey, &QHotkey::activated, this, [this, action]() {
+		emit activated(action);
+	});
+	connect(hotkey, &QHotkey::released, this, [this, action]() {
+		emit released(action);
+	});
+	return hotkey;
+}
@@ -0,0 +1,54 @@
+#ifndef QHOTKEYPROFILE_H
+#define QHOTKEYPROFILE_H
+
+#include "qhotkey.h"
+
+class QSettings;
+
+//! A named set of hotkeys that can be replaced as a whole, only regrabbing what changed
+class QHOTKEY_EXPORT QHotkeyProfile : public QObject
+{
+	Q_OBJECT
+
+public:
+	//! Default Constructor
+	explicit QHotkeyProfile(QObject *parent = nullptr);
+	~QHotkeyProfile() override;
+
+	//! Returns the key sequence of every action of the profile
+	QHash<QString, QKeySequence> bindings() const;
+	//! Returns the hotkey of the given action, or nullptr if there is none
+	QHotkey *hotkey(const QString &action) const;
+	//! Returns the actions whose hotkey could not be registered
+	QStringList failedActions() const;
+
+	//! Returns the bindings as JSON object, with the actions as keys and the sequences as portable strings
+	QJsonObject toJson() const;
+	//! Stores the bindings in the current group of the settings
+	void saveSettings(QSettings *settings) const;
+
+public Q_SLOTS:
+	//! Replaces all bindings, only grabbing and releasing the keys that changed
+	bool setBindings(const QHash<QString, QKeySequence> &bindings);
+	//! Removes all bindings
+	void clear();
+
+	//! Replaces the bindings with the ones of a JSON object, like created by toJson()
+	bool loadJson(const QJsonObject &object);
+	//! Replaces the bindings with the ones of the current group of the settings
+	bool loadSettings(QSettings *settings);
+
+Q_SIGNALS:
+	//! Will be emitted if the hotkey of the action is pressed
+	void activated(const QString &action);
+	//! Will be emitted if the hotkey of the action is released
+	void released(const QString &action);
+
+private:
+	QHash<QString, QKeySequence> _bindings;
+	QHash<QString, QHotkey*> _hotkeys;
+
+	QHotkey *createHotkey(const QString &action, const QKeySequence &sequence);
+};
+
+#endif // QHOTKEYPROFILE_H
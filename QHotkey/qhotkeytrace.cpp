@@ -0,0 +1,299 @@
+#include "qhotkeytrace.h"
+#include "qhotkey_p.h"
+#include <QIODevice>
+#include <QThread>
+#include <QTimer>
+#include <QtEndian>
+#include <QDebug>
+#include <cstring>
+
+namespace {
+
+// all numbers are little endian. The header holds the magic, the format version, the backend name and the native
+// event type, each name prefixed with its length as one byte. Every event follows as the nanoseconds since the
+// recording was started (8 bytes), the size of the message (2 bytes) and the raw message itself
+const char TraceMagic[8] = {'Q', 'H', 'K', 'T', 'R', 'A', 'C', 'E'};
+const quint32 TraceVersion = 1;
+const int EventHeaderSize = 10;
+// events are collected and written in chunks, so recording does not cost a write per key
+const int TraceFlushSize = 64 * 1024;
+
+template <typename T>
+void appendLittleEndian(QByteArray &buffer, T value)
+{
+	const T converted = qToLittleEndian(value);
+	buffer.append(reinterpret_cast<const char*>(&converted), sizeof(converted));
+}
+
+}
+
+
+
+QHotkeyTrace::QHotkeyTrace(QObject *parent) :
+	QObject(parent),
+	_device(nullptr),
+	_startNsecs(0),
+	_recordedEvents(0),
+	_replaying(false),
+	_nextEvent(0),
+	_replayStartNsecs(0),
+	_filterNsecs(0),
+	_replayTimer(new QTimer(this))
+{
+	_replayTimer->setSingleShot(true);
+	_replayTimer->setTimerType(Qt::PreciseTimer);
+	connect(_replayTimer, &QTimer::timeout,
+			this, &QHotkeyTrace::replayDue);
+}
+
+QHotkeyTrace::~QHotkeyTrace()
+{
+	stopReplay();
+	stopRecording();
+}
+
+bool QHotkeyTrace::startRecording(QIODevice *device)
+{
+	if(_device) {
+		qCWarning(logQHotkey) << "The trace is already recording";
+		return false;
+	}
+	if(!device || !device->isWritable()) {
+		qCWarning(logQHotkey) << "The trace device is not open for writing";
+		return false;
+	}
+
+	QHotkeyPrivate *hotkeyPrivate = QHotkeyPrivate::instance();
+	const QByteArray eventType = hotkeyPrivate->traceEventType();
+	if(eventType.isEmpty()) {
+		qCWarning(logQHotkey) << "The" << QHotkey::backend() << "backend does not support traces";
+		return false;
+	}
+
+	const QByteArray backend = QHotkey::backend().toLatin1();
+	_buffer.clear();
+	_buffer.append(TraceMagic, sizeof(TraceMagic));
+	appendLittleEndian<quint32>(_buffer, TraceVersion);
+	appendLittleEndian<quint8>(_buffer, static_cast<quint8>(backend.size()));
+	_buffer.append(backend);
+	appendLittleEndian<quint8>(_buffer, static_cast<quint8>(eventType.size()));
+	_buffer.append(eventType);
+
+	_device = device;
+	_recordedEvents = 0;
+	_startNsecs = QHotkeyEvent::currentNsecs();
+	if(!hotkeyPrivate->attachTrace(this)) {
+		qCWarning(logQHotkey) << "A different trace is already recording";
+		_device = nullptr;
+		_buffer.clear();
+		return false;
+	}
+	return true;
+}
+
+void QHotkeyTrace::stopRecording()
+{
+	if(!_device)
+		return;
+
+	QHotkeyPrivate::instance()->detachTrace(this);
+	writePendingChunks();
+	writeChunk(_buffer);
+	_buffer.clear();
+	_device = nullptr;
+}
+
+bool QHotkeyTrace::isRecording() const
+{
+	return _device;
+}
+
+quint64 QHotkeyTrace::recordedEvents() const
+{
+	return _recordedEvents.load(std::memory_order_relaxed);
+}
+
+bool QHotkeyTrace::replay(QIODevice *device, ReplaySpeed speed)
+{
+	if(_replaying) {
+		qCWarning(logQHotkey) << "The trace is already replaying";
+		return false;
+	}
+	QHotkeyPrivate *hotkeyPrivate = QHotkeyPrivate::instance();
+	if(QThread::currentThread() != hotkeyPrivate->thread() || thread() != hotkeyPrivate->thread()) {
+		qCWarning(logQHotkey) << "Traces can only be replayed on the thread of the hotkey backend";
+		return false;
+	}
+	if(!device || !device->isReadable()) {
+		qCWarning(logQHotkey) << "The trace device is not open for reading";
+		return false;
+	}
+	if(!readTrace(device))
+		return false;
+
+	_replaying = true;
+	_nextEvent = 0;
+	_filterNsecs = 0;
+	_replayStartNsecs = QHotkeyEvent::currentNsecs();
+	if(speed == MaximumSpeed) {
+		// a slot may stop the replay while it runs
+		while(_replaying && _nextEvent < _events.size())
+			feedEvent(_nextEvent++);
+		if(_replaying)
+			finishReplay();
+	} else
+		replayDue();
+	return true;
+}
+
+void QHotkeyTrace::stopReplay()
+{
+	if(_replaying)
+		finishReplay();
+}
+
+bool QHotkeyTrace::isReplaying() const
+{
+	return _replaying;
+}
+
+void QHotkeyTrace::recordEvent(const void *message, int size)
+{
+	appendLittleEndian<quint64>(_buffer, static_cast<quint64>(QHotkeyEvent::currentNsecs() - _startNsecs));
+	appendLittleEndian<quint16>(_buffer, static_cast<quint16>(size));
+	_buffer.append(static_cast<const char*>(message), size);
+	_recordedEvents.fetch_add(1, std::memory_order_relaxed);
+	if(_buffer.size() < TraceFlushSize)
+		return;
+
+	QByteArray chunk;
+	chunk.swap(_buffer);
+	_buffer.reserve(TraceFlushSize + EventHeaderSize + size);
+	bool firstChunk = false;
+	{
+		QMutexLocker locker(&_chunkMutex);
+		firstChunk = _pendingChunks.isEmpty();
+		_pendingChunks.append(chunk);
+	}
+	if(firstChunk) {
+		QMetaObject::invokeMethod(this, [this]() {
+			writePendingChunks();
+		}, Qt::QueuedConnection);
+	}
+}
+
+void QHotkeyTrace::writePendingChunks()
+{
+	QList<QByteArray> chunks;
+	{
+		QMutexLocker locker(&_chunkMutex);
+		chunks.swap(_pendingChunks);
+	}
+	for(const QByteArray &chunk : chunks)
+		writeChunk(chunk);
+}
+
+bool QHotkeyTrace::writeChunk(const QByteArray &chunk)
+{
+	if(chunk.isEmpty() || !_device)
+		return true;
+
+	const bool ok = _device->write(chunk) == chunk.size();
+	if(!ok)
+		qCWarning(logQHotkey) << "Failed to write the hotkey trace with error:" << _device->errorString();
+	return ok;
+}
+
+bool QHotkeyTrace::readTrace(QIODevice *device)
+{
+	const QByteArray data = device->readAll();
+	const char *raw = data.constData();
+	const int headerSize = static_cast<int>(sizeof(TraceMagic) + sizeof(quint32));
+	if(data.size() < headerSize || std::memcmp(raw, TraceMagic, sizeof(TraceMagic)) != 0) {
+		qCWarning(logQHotkey) << "The device does not contain a hotkey trace";
+		return false;
+	}
+	const quint32 version = qFromLittleEndian<quint32>(raw + sizeof(TraceMagic));
+	if(version != TraceVersion) {
+		qCWarning(logQHotkey) << "Unsupported hotkey trace version" << version;
+		return false;
+	}
+
+	int pos = headerSize;
+	QByteArray names[2];
+	for(QByteArray &name : names) {
+		if(pos >= data.size() || data.size() - pos - 1 < static_cast<quint8>(raw[pos])) {
+			qCWarning(logQHotkey) << "The header of the hotkey trace is truncated";
+			return false;
+		}
+		const int size = static_cast<quint8>(raw[pos++]);
+		name = data.mid(pos, size);
+		pos += size;
+	}
+
+	// the messages are only meaningful to the backend that recorded them
+	QHotkeyPrivate *hotkeyPrivate = QHotkeyPrivate::instance();
+	const QByteArray backend = QHotkey::backend().toLatin1();
+	const QByteArray eventType = hotkeyPrivate->traceEventType();
+	if(names[0] != backend || names[1] != eventType) {
+		qCWarning(logQHotkey) << "The hotkey trace was recorded with the" << names[0]
+							  << "backend, but the" << backend << "backend is used";
+		return false;
+	}
+
+	// the events are prepared for this session up front, so feeding them costs no copy
+	_eventType = eventType;
+	_events.clear();
+	while(pos < data.size()) {
+		const int size = data.size() - pos < EventHeaderSize ? -1 : qFromLittleEndian<quint16>(raw + pos + 8);
+		if(size < 0 || data.size() - pos - EventHeaderSize < size) {
+			// happens when the application ended before the recording was stopped
+			qCWarning(logQHotkey) << "Ignoring the truncated last event of the hotkey trace";
+			break;
+		}
+		if(size == 0) {
+			// the event filters get no size, so they must never see an empty message
+			pos += EventHeaderSize;
+			continue;
+		}
+		const qint64 nsecs = static_cast<qint64>(qFromLittleEndian<quint64>(raw + pos));
+		QByteArray message = data.mid(pos + EventHeaderSize, size);
+		hotkeyPrivate->prepareReplay(message);
+		_events.append({nsecs, message});
+		pos += EventHeaderSize + size;
+	}
+	return true;
+}
+
+void QHotkeyTrace::replayDue()
+{
+	while(_replaying && _nextEvent < _events.size() &&
+		  _events[_nextEvent].nsecs <= QHotkeyEvent::currentNsecs() - _replayStartNsecs)
+		feedEvent(_nextEvent++);
+	if(!_replaying)
+		return;
+
+	if(_nextEvent < _events.size()) {
+		// pace against the start of the replay, so a late timer does not delay all following events
+		const qint64 aheadNsecs = _events[_nextEvent].nsecs - (QHotkeyEvent::currentNsecs() - _replayStartNsecs);
+		_replayTimer->start(static_cast<int>(qMax<qint64>(0, (aheadNsecs + 999999) / 1000000)));
+	} else
+		finishReplay();
+}
+
+void QHotkeyTrace::feedEvent(int index)
+{
+	const qint64 start = QHotkeyEvent::currentNsecs();
+	QHotkeyPrivate::instance()->replayEvent(_eventType, _events[index].message.data());
+	_filterNsecs += QHotkeyEvent::currentNsecs() - start;
+}
+
+void QHotkeyTrace::finishReplay()
+{
+	_replayTimer->stop();
+	_replaying = false;
+	const quint64 events = static_cast<quint64>(_nextEvent);
+	_events.clear();
+	_nextEvent = 0;
+	emit replayFinished(events, _filterNsecs);
+}
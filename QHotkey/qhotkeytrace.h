@@ -0,0 +1,83 @@
+#ifndef QHOTKEYTRACE_H
+#define QHOTKEYTRACE_H
+
+#include "qhotkey.h"
+#include <QMutex>
+#include <atomic>
+
+class QIODevice;
+class QTimer;
+
+//! Records the raw native events of the hotkey backend into a binary trace, and feeds them back in later on
+class QHOTKEY_EXPORT QHotkeyTrace : public QObject
+{
+	Q_OBJECT
+	//! @private
+	friend class QHotkeyPrivate;
+
+public:
+	//! Defines how fast a trace is replayed
+	enum ReplaySpeed {
+		OriginalSpeed, //!< The events are fed with the delays they were recorded with, from the eventloop
+		MaximumSpeed //!< All events are fed right away, without returning to the eventloop in between
+	};
+	Q_ENUM(ReplaySpeed)
+
+	//! Default Constructor
+	explicit QHotkeyTrace(QObject *parent = nullptr);
+	~QHotkeyTrace() override;
+
+	//! Starts to write the native events of the backend to the device, which must be open for writing
+	bool startRecording(QIODevice *device);
+	//! Stops recording and writes the remaining events to the device
+	void stopRecording();
+	//! Checks whether events are currently recorded
+	bool isRecording() const;
+	//! Returns the number of events recorded since the recording was started
+	quint64 recordedEvents() const;
+
+	//! Reads a trace from the device and feeds its events to the backend
+	bool replay(QIODevice *device, ReplaySpeed speed = OriginalSpeed);
+	//! Cancels the running replay
+	void stopReplay();
+	//! Checks whether a replay is still running
+	bool isReplaying() const;
+
+Q_SIGNALS:
+	//! Will be emitted once a replay has fed all of its events to the backend, or was stopped
+	void replayFinished(quint64 events, qint64 filterNsecs);
+
+private:
+	struct Event {
+		qint64 nsecs;
+		QByteArray message;
+	};
+
+	// recording, the events come in on the thread of the backend or its listener thread. Full buffers are handed
+	// to the thread of the trace, so writing to the device never delays the events
+	QIODevice *_device;
+	QByteArray _buffer;
+	qint64 _startNsecs;
+	std::atomic<quint64> _recordedEvents;
+	QMutex _chunkMutex;
+	QList<QByteArray> _pendingChunks;
+
+	// replaying, only on the thread of the backend
+	bool _replaying;
+	QByteArray _eventType;
+	QVector<Event> _events;
+	int _nextEvent;
+	qint64 _replayStartNsecs;
+	qint64 _filterNsecs;
+	QTimer *_replayTimer;
+
+	void recordEvent(const void *message, int size);//called by QHotkeyPrivate, serialized by it
+	void writePendingChunks();
+	bool writeChunk(const QByteArray &chunk);
+	bool readTrace(QIODevice *device);
+	void replayDue();
+	void feedEvent(int index);
+	void finishReplay();
+};
+
+#endif // QHOTKEYTRACE_H
@@ -0,0 +1,155 @@
+#include <QtTest>
+#include <QHotkey>
+#include <linux/uinput.h>
+#include <sys/ioctl.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstring>
+
+class EvdevBackendTest : public QObject
+{
+	Q_OBJECT
+
+private Q_SLOTS:
+	void initTestCase();
+	void cleanupTestCase();
+
+	void activation();
+	void hotplug();
+
+private:
+	QList<int> keyboards;
+
+	static int createKeyboard();
+	static QString deviceNode(int keyboard);
+	static bool waitForDevice(int keyboard);
+	static void sendKey(int keyboard, quint16 code, qint32 value);
+};
+
+void EvdevBackendTest::initTestCase()
+{
+	QVERIFY(QHotkey::setBackend(QStringLiteral("evdev")));
+
+	// a keyboard must exist before the first hotkey is registered
+	const int keyboard = createKeyboard();
+	if(keyboard < 0)
+		QSKIP("The evdev tests need write access to /dev/uinput");
+	keyboards.append(keyboard);
+	if(!waitForDevice(keyboard))
+		QSKIP("The evdev tests need read access to the event devices");
+}
+
+void EvdevBackendTest::cleanupTestCase()
+{
+	for(int keyboard : keyboards) {
+		ioctl(keyboard, UI_DEV_DESTROY);
+		::close(keyboard);
+	}
+}
+
+void EvdevBackendTest::activation()
+{
+	QHotkey hotkey(Qt::Key_F24, Qt::ShiftModifier, true);
+	QVERIFY2(hotkey.isRegistered(), "No readable keyboard found");
+	QSignalSpy activated(&hotkey, &QHotkey::activated);
+	QSignalSpy released(&hotkey, &QHotkey::released);
+
+	const int keyboard = keyboards.first();
+	sendKey(keyboard, KEY_LEFTSHIFT, 1);
+	sendKey(keyboard, KEY_F24, 1);
+	QTRY_COMPARE(activated.count(), 1);
+
+	// released with the modifiers of the press, even though shift goes up first
+	sendKey(keyboard, KEY_LEFTSHIFT, 0);
+	sendKey(keyboard, KEY_F24, 0);
+	QTRY_COMPARE(released.count(), 1);
+	QCOMPARE(activated.count(), 1);
+}
+
+void EvdevBackendTest::hotplug()
+{
+	QHotkey hotkey(Qt::Key_F23, Qt::NoModifier, true);
+	QVERIFY(hotkey.isRegistered());
+	QSignalSpy activated(&hotkey, &QHotkey::activated);
+
+	// plugged in after the listener has started
+	const int keyboard = createKeyboard();
+	QVERIFY(keyboard >= 0);
+	keyboards.append(keyboard);
+	QVERIFY(waitForDevice(keyboard));
+
+	// the listener opens the device once udev has granted the access, so keep tapping until it arrives
+	for(int i = 0; i < 100 && activated.isEmpty(); ++i) {
+		sendKey(keyboard, KEY_F23, 1);
+		sendKey(keyboard, KEY_F23, 0);
+		QTest::qWait(50);
+	}
+	QVERIFY(!activated.isEmpty());
+}
+
+int EvdevBackendTest::createKeyboard()
+{
+	const int fd = ::open("/dev/uinput", O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+	if(fd < 0)
+		return -1;
+
+	ioctl(fd, UI_SET_EVBIT, EV_KEY);
+	ioctl(fd, UI_SET_EVBIT, EV_SYN);
+	// the backend only accepts devices with letters and a space bar as keyboards
+	for(int code : {KEY_A, KEY_Z, KEY_SPACE, KEY_LEFTSHIFT, KEY_F23, KEY_F24})
+		ioctl(fd, UI_SET_KEYBIT, code);
+
+	uinput_setup setup;
+	std::memset(&setup, 0, sizeof(setup));
+	setup.id.bustype = BUS_VIRTUAL;
+	setup.id.vendor = 0x1;
+	setup.id.product = 0x1;
+	std::strncpy(setup.name, "QHotkey test keyboard", UINPUT_MAX_NAME_SIZE - 1);
+	if(ioctl(fd, UI_DEV_SETUP, &setup) < 0 || ioctl(fd, UI_DEV_CREATE) < 0) {
+		::close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+QString EvdevBackendTest::deviceNode(int keyboard)
+{
+	char sysName[64] = {};
+	if(ioctl(keyboard, UI_GET_SYSNAME(sizeof(sysName) - 1), sysName) < 0)
+		return QString();
+
+	const QDir sysDir(QStringLiteral("/sys/devices/virtual/input/") + QString::fromLatin1(sysName));
+	const QStringList events = sysDir.entryList({QStringLiteral("event*")}, QDir::Dirs);
+	if(events.isEmpty())
+		return QString();
+	return QStringLiteral("/dev/input/") + events.first();
+}
+
+bool EvdevBackendTest::waitForDevice(int keyboard)
+{
+	// the node appears with the device, but udev may adjust its permissions a moment later
+	for(int i = 0; i < 40; ++i) {
+		const QString node = deviceNode(keyboard);
+		if(!node.isEmpty() && QFileInfo(node).isReadable())
+			return true;
+		QTest::qWait(50);
+	}
+	return false;
+}
+
+void EvdevBackendTest::sendKey(int keyboard, quint16 code, qint32 value)
+{
+	input_event events[2];
+	std::memset(events, 0, sizeof(events));
+	events[0].type = EV_KEY;
+	events[0].code = code;
+	events[0].value = value;
+	events[1].type = EV_SYN;
+	events[1].code = SYN_REPORT;
+	if(::write(keyboard, events, sizeof(events)) != sizeof(events))
+		qWarning() << "Failed to send a key event:" << std::strerror(errno);
+}
+
+QTEST_GUILESS_MAIN(EvdevBackendTest)
+
+#include "tst_evdevbackend.moc"
@@ -0,0 +1,543 @@
+#include <QtTest>
+#include <QHotkey>
+#include <QHotkeyProfile>
+#include <QHotkeyTrace>
+#include <QWindow>
+#include "qhotkey_virtual_p.h"
+
+class VirtualBackendTest : public QObject
+{
+	Q_OBJECT
+
+private Q_SLOTS:
+	void initTestCase();
+
+	void activation();
+	void directDelivery();
+	void sharedShortcut();
+	void rejectedShortcut();
+	void deleteWhileInjecting();
+	void globalWhileFocused();
+	void registerAllPartialFailure();
+	void registerAsync();
+	void chord();
+	void profileDiff();
+	void deferredUngrab();
+	void repeatPolicies();
+	void modifierOnly();
+	void holdThreshold();
+	void probeAndQuery();
+	void traceReplay();
+
+private:
+	QHotkeyPrivateVirtual *backend = nullptr;
+};
+
+void VirtualBackendTest::initTestCase()
+{
+	// it must never replace a real backend on its own
+	if(qEnvironmentVariableIsEmpty("QHOTKEY_BACKEND") && QHotkey::availableBackends().size() > 1)
+		QVERIFY(QHotkey::backend() != QStringLiteral("virtual"));
+
+	QVERIFY(QHotkey::setBackend(QStringLiteral("virtual")));
+	backend = QHotkeyPrivateVirtual::virtualInstance();
+	QVERIFY(backend);
+	QCOMPARE(QHotkey::backend(), QStringLiteral("virtual"));
+}
+
+void VirtualBackendTest::activation()
+{
+	QHotkey hotkey(Qt::Key_A, Qt::ControlModifier, true);
+	QVERIFY(hotkey.isRegistered());
+	const QHotkey::NativeShortcut shortcut = hotkey.currentNativeShortcut();
+	QVERIFY(backend->isShortcutGrabbed(shortcut));
+
+	QSignalSpy activated(&hotkey, &QHotkey::activated);
+	QSignalSpy released(&hotkey, &QHotkey::released);
+	backend->injectPress(shortcut);
+	QTRY_COMPARE(activated.count(), 1);
+	QCOMPARE(released.count(), 0);
+	backend->injectRelease(shortcut);
+	QTRY_COMPARE(released.count(), 1);
+	QCOMPARE(activated.count(), 1);
+
+	// keys without a registered hotkey are not grabbed, so nothing is emitted for them
+	QVERIFY(hotkey.setRegistered(false));
+	QVERIFY(!backend->isShortcutGrabbed(shortcut));
+	backend->injectPress(shortcut);
+	backend->injectRelease(shortcut);
+	QCoreApplication::processEvents();
+	QCOMPARE(activated.count(), 1);
+	QCOMPARE(released.count(), 1);
+}
+
+void VirtualBackendTest::directDelivery()
+{
+	QHotkey hotkey(Qt::Key_B, Qt::ControlModifier, true);
+	hotkey.setDeliveryMode(QHotkey::DirectDelivery);
+	const QHotkey::NativeShortcut shortcut = hotkey.currentNativeShortcut();
+
+	// injected on the thread of the hotkey, so the signals are emitted before the calls return
+	QSignalSpy activated(&hotkey, &QHotkey::activated);
+	QSignalSpy released(&hotkey, &QHotkey::released);
+	backend->injectPress(shortcut);
+	QCOMPARE(activated.count(), 1);
+	backend->injectRelease(shortcut);
+	QCOMPARE(released.count(), 1);
+}
+
+void VirtualBackendTest::sharedShortcut()
+{
+	QHotkey first(Qt::Key_C, Qt::AltModifier, true);
+	QHotkey second(Qt::Key_C, Qt::AltModifier, true);
+	QVERIFY(first.isRegistered());
+	QVERIFY(second.isRegistered());
+	const QHotkey::NativeShortcut shortcut = first.currentNativeShortcut();
+	QVERIFY(second.currentNativeShortcut() == shortcut);
+
+	QSignalSpy firstActivated(&first, &QHotkey::activated);
+	QSignalSpy secondActivated(&second, &QHotkey::activated);
+	backend->injectPress(shortcut);
+	backend->injectRelease(shortcut);
+	QTRY_COMPARE(firstActivated.count(), 1);
+	QTRY_COMPARE(secondActivated.count(), 1);
+
+	// the grab stays until the last hotkey of the key is gone
+	QVERIFY(second.setRegistered(false));
+	QVERIFY(backend->isShortcutGrabbed(shortcut));
+	backend->injectPress(shortcut);
+	backend->injectRelease(shortcut);
+	QTRY_COMPARE(firstActivated.count(), 2);
+	QCOMPARE(secondActivated.count(), 1);
+
+	QVERIFY(first.setRegistered(false));
+	QVERIFY(!backend->isShortcutGrabbed(shortcut));
+}
+
+void VirtualBackendTest::rejectedShortcut()
+{
+	const QHotkey::NativeShortcut shortcut(Qt::Key_D, Qt::ShiftModifier);
+	backend->setShortcutRejected(shortcut, true);
+	QHotkey hotkey(shortcut);
+	QVERIFY(!hotkey.setRegistered(true));
+	QVERIFY(!hotkey.isRegistered());
+
+	backend->setShortcutRejected(shortcut, false);
+	QVERIFY(hotkey.setRegistered(true));
+	QVERIFY(backend->isShortcutGrabbed(shortcut));
+}
+
+void VirtualBackendTest::deleteWhileInjecting()
+{
+	// the injector dispatches on its own thread, while the hotkeys it delivers to are deleted on this one
+	const QHotkey::NativeShortcut shortcut(Qt::Key_E, Qt::MetaModifier);
+	QHotkey observer(shortcut, true);
+	QVERIFY(observer.isRegistered());
+	QSignalSpy activated(&observer, &QHotkey::activated);
+
+	QVERIFY(backend->startInjection({shortcut}, 20000));
+	for(int i = 0; i < 500; ++i) {
+		auto hotkey = new QHotkey(shortcut, true);
+		QVERIFY(hotkey->isRegistered());
+		QCoreApplication::processEvents();
+		delete hotkey;
+	}
+	QTRY_VERIFY(activated.count() > 0);
+	backend->stopInjection();
+	QVERIFY(backend->injectedEvents() > 0);
+}
+
+void VirtualBackendTest::globalWhileFocused()
+{
+	QWindow window;
+	window.show();
+	window.requestActivate();
+	if(!QTest::qWaitForWindowActive(&window))
+		QSKIP("The platform cannot activate windows");
+
+	QHotkey global(Qt::Key_F, Qt::ControlModifier, true);
+	QHotkey scoped(Qt::Key_G, Qt::ControlModifier);
+	QVERIFY(scoped.setScope(QHotkey::ActiveWindowScope, 0, true));
+	QVERIFY(global.isRegistered());
+	QVERIFY(scoped.isRegistered());
+	QVERIFY(backend->isWindowShortcutGrabbed(scoped.currentNativeShortcut(), window.winId()));
+
+	// global grabs report their keys for the focus window of the application, like X11 does
+	QSignalSpy globalActivated(&global, &QHotkey::activated);
+	QSignalSpy globalReleased(&global, &QHotkey::released);
+	backend->injectPress(global.currentNativeShortcut(), window.winId());
+	backend->injectRelease(global.currentNativeShortcut(), window.winId());
+	QTRY_COMPARE(globalActivated.count(), 1);
+	QTRY_COMPARE(globalReleased.count(), 1);
+
+	QSignalSpy scopedActivated(&scoped, &QHotkey::activated);
+	backend->injectPress(scoped.currentNativeShortcut(), window.winId());
+	backend->injectRelease(scoped.currentNativeShortcut(), window.winId());
+	QTRY_COMPARE(scopedActivated.count(), 1);
+	QCOMPARE(globalActivated.count(), 1);
+}
+
+void VirtualBackendTest::registerAllPartialFailure()
+{
+	const QHotkey::NativeShortcut rejected(Qt::Key_H, Qt::ControlModifier);
+	backend->setShortcutRejected(rejected, true);
+	QHotkey first(Qt::Key_H, Qt::AltModifier);
+	QHotkey second(rejected);
+	QHotkey third(Qt::Key_I, Qt::AltModifier);
+	QSignalSpy firstChanged(&first, &QHotkey::registeredChanged);
+	QSignalSpy secondChanged(&second, &QHotkey::registeredChanged);
+
+	// only the rejected one fails, the others stay registered
+	QCOMPARE(QHotkey::registerAll({&first, &second, &third}), QList<QHotkey*>{&second});
+	QVERIFY(first.isRegistered());
+	QVERIFY(!second.isRegistered());
+	QVERIFY(third.isRegistered());
+	QVERIFY(backend->isShortcutGrabbed(first.currentNativeShortcut()));
+	QVERIFY(!backend->isShortcutGrabbed(rejected));
+	QVERIFY(backend->isShortcutGrabbed(third.currentNativeShortcut()));
+	QCOMPARE(firstChanged.count(), 1);
+	QCOMPARE(secondChanged.count(), 0);
+
+	QVERIFY(QHotkey::unregisterAll({&first, &second, &third}).isEmpty());
+	QVERIFY(!first.isRegistered());
+	QVERIFY(!third.isRegistered());
+	QVERIFY(!backend->isShortcutGrabbed(first.currentNativeShortcut()));
+	QVERIFY(!backend->isShortcutGrabbed(third.currentNativeShortcut()));
+	QCOMPARE(firstChanged.count(), 2);
+	backend->setShortcutRejected(rejected, false);
+}
+
+void VirtualBackendTest::registerAsync()
+{
+	QHotkey hotkey(Qt::Key_J, Qt::ControlModifier);
+	QSignalSpy changed(&hotkey, &QHotkey::registeredChanged);
+
+	// the main thread registers before the call returns
+	QFuture<bool> registered = hotkey.registerAsync();
+	QVERIFY(registered.isFinished());
+	QVERIFY(registered.result());
+	QVERIFY(hotkey.isRegistered());
+	QCOMPARE(changed.count(), 1);
+
+	// other threads queue it to the main eventloop
+	QFuture<bool> unregistered;
+	QScopedPointer<QThread> thread(QThread::create([&hotkey, &unregistered]() {
+		unregistered = hotkey.unregisterAsync();
+	}));
+	thread->start();
+	QVERIFY(thread->wait(5000));
+	QVERIFY(!unregistered.isFinished());
+	QTRY_VERIFY(unregistered.isFinished());
+	QVERIFY(unregistered.result());
+	QVERIFY(!hotkey.isRegistered());
+	QVERIFY(!backend->isShortcutGrabbed(hotkey.currentNativeShortcut()));
+	QTRY_COMPARE(changed.count(), 2);
+
+	// a hotkey deleted before its queued registration ran is never touched by it
+	const QHotkey::NativeShortcut shortcut(Qt::Key_K, Qt::ControlModifier);
+	auto doomed = new QHotkey(shortcut);
+	QFuture<bool> cancelled;
+	thread.reset(QThread::create([doomed, &cancelled]() {
+		cancelled = doomed->registerAsync();
+	}));
+	thread->start();
+	QVERIFY(thread->wait(5000));
+	delete doomed;
+	QTRY_VERIFY(cancelled.isFinished());
+	QVERIFY(!cancelled.result());
+	QVERIFY(!backend->isShortcutGrabbed(shortcut));
+}
+
+void VirtualBackendTest::chord()
+{
+	QHotkey sequence(QKeySequence(QStringLiteral("Ctrl+L, M")), true);
+	QHotkey plain(Qt::Key_L, Qt::ControlModifier, true);
+	QVERIFY(sequence.isRegistered());
+	const QHotkey::NativeShortcut prefix = sequence.currentNativeShortcut();
+	const QHotkey::NativeShortcut next(Qt::Key_M, Qt::NoModifier);
+	QVERIFY(backend->isShortcutGrabbed(prefix));
+	QVERIFY(!backend->isShortcutGrabbed(next));
+
+	// the prefix only grabs the following key, but still reaches plain hotkeys
+	QSignalSpy activated(&sequence, &QHotkey::activated);
+	QSignalSpy plainActivated(&plain, &QHotkey::activated);
+	backend->injectPress(prefix);
+	backend->injectRelease(prefix);
+	QVERIFY(backend->isShortcutGrabbed(next));
+	QTRY_COMPARE(plainActivated.count(), 1);
+	QCOMPARE(activated.count(), 0);
+	backend->injectPress(next);
+	backend->injectRelease(next);
+	QTRY_COMPARE(activated.count(), 1);
+	QVERIFY(!backend->isShortcutGrabbed(next));
+
+	// once the timeout expires, the following key is released and does nothing
+	const int timeout = QHotkey::chordTimeout();
+	QHotkey::setChordTimeout(50);
+	backend->injectPress(prefix);
+	backend->injectRelease(prefix);
+	QVERIFY(backend->isShortcutGrabbed(next));
+	QTRY_VERIFY(!backend->isShortcutGrabbed(next));
+	backend->injectPress(next);
+	backend->injectRelease(next);
+	QCoreApplication::processEvents();
+	QCOMPARE(activated.count(), 1);
+	QHotkey::setChordTimeout(timeout);
+}
+
+void VirtualBackendTest::profileDiff()
+{
+	const QKeySequence first(QStringLiteral("Ctrl+N"));
+	const QKeySequence second(QStringLiteral("Ctrl+O"));
+	const QKeySequence third(QStringLiteral("Ctrl+P"));
+	const QHotkey::NativeShortcut secondShortcut(Qt::Key_O, Qt::ControlModifier);
+	const QHotkey::NativeShortcut thirdShortcut(Qt::Key_P, Qt::ControlModifier);
+
+	QHotkeyProfile profile;
+	QVERIFY(profile.setBindings({{QStringLiteral("copy"), first}, {QStringLiteral("paste"), second}}));
+	QHotkey *copy = profile.hotkey(QStringLiteral("copy"));
+	QHotkey *paste = profile.hotkey(QStringLiteral("paste"));
+	QVERIFY(copy && copy->isRegistered());
+	QVERIFY(paste && paste->isRegistered());
+
+	// unchanged actions keep their hotkey, a key that moves to another action stays grabbed, so only Ctrl+P is new
+	QHotkeyStats::setEnabled(true);
+	QHotkeyStats::reset();
+	QVERIFY(profile.setBindings({
+		{QStringLiteral("copy"), first},
+		{QStringLiteral("paste"), third},
+		{QStringLiteral("cut"), second}
+	}));
+	QCOMPARE(QHotkeyStats::snapshot().registrations, Q_UINT64_C(1));
+	QHotkeyStats::setEnabled(false);
+	QCOMPARE(profile.hotkey(QStringLiteral("copy")), copy);
+	QVERIFY(profile.hotkey(QStringLiteral("paste")) != paste);
+	QVERIFY(backend->isShortcutGrabbed(secondShortcut));
+	QVERIFY(backend->isShortcutGrabbed(thirdShortcut));
+
+	QSignalSpy activated(&profile, &QHotkeyProfile::activated);
+	backend->injectPress(secondShortcut);
+	backend->injectRelease(secondShortcut);
+	QTRY_COMPARE(activated.count(), 1);
+	QCOMPARE(activated.first().first().toString(), QStringLiteral("cut"));
+
+	profile.clear();
+	QVERIFY(profile.bindings().isEmpty());
+	QVERIFY(!backend->isShortcutGrabbed(secondShortcut));
+	QVERIFY(!backend->isShortcutGrabbed(thirdShortcut));
+}
+
+void VirtualBackendTest::deferredUngrab()
+{
+	QHotkey::setUngrabDelay(200);
+	QHotkey hotkey(Qt::Key_Q, Qt::AltModifier, true);
+	const QHotkey::NativeShortcut shortcut = hotkey.currentNativeShortcut();
+	QVERIFY(hotkey.setRegistered(false));
+	QVERIFY(backend->isShortcutGrabbed(shortcut));
+
+	// registering it again within the delay reuses the grab
+	QHotkeyStats::setEnabled(true);
+	QHotkeyStats::reset();
+	QVERIFY(hotkey.setRegistered(true));
+	QCOMPARE(QHotkeyStats::snapshot().registrations, Q_UINT64_C(0));
+	QHotkeyStats::setEnabled(false);
+	QSignalSpy activated(&hotkey, &QHotkey::activated);
+	backend->injectPress(shortcut);
+	backend->injectRelease(shortcut);
+	QTRY_COMPARE(activated.count(), 1);
+
+	// and without it, the key is released once the delay expired
+	QVERIFY(hotkey.setRegistered(false));
+	QVERIFY(backend->isShortcutGrabbed(shortcut));
+	QTRY_VERIFY(!backend->isShortcutGrabbed(shortcut));
+
+	// no delay releases the remaining grabs immediately
+	QVERIFY(hotkey.setRegistered(true));
+	QVERIFY(hotkey.setRegistered(false));
+	QHotkey::setUngrabDelay(0);
+	QVERIFY(!backend->isShortcutGrabbed(shortcut));
+}
+
+void VirtualBackendTest::repeatPolicies()
+{
+	QHotkey hotkey(Qt::Key_R, Qt::AltModifier, true);
+	hotkey.setDeliveryMode(QHotkey::DirectDelivery);
+	const QHotkey::NativeShortcut shortcut = hotkey.currentNativeShortcut();
+	QSignalSpy activated(&hotkey, &QHotkey::activated);
+	QSignalSpy repeated(&hotkey, &QHotkey::repeated);
+	const auto holdKey = [this, shortcut](int repeats) {
+		backend->injectPress(shortcut);
+		for(int i = 0; i < repeats; ++i)
+			backend->injectRepeat(shortcut);
+		backend->injectRelease(shortcut);
+	};
+
+	// the default drops all repeats
+	QCOMPARE(hotkey.repeatPolicy(), QHotkey::IgnoreRepeats);
+	holdKey(3);
+	QCOMPARE(activated.count(), 1);
+	QCOMPARE(repeated.count(), 0);
+
+	// coalesced repeats activate again, but only once per interval
+	hotkey.setRepeatPolicy(QHotkey::CoalesceRepeats);
+	hotkey.setRepeatInterval(0);
+	activated.clear();
+	holdKey(3);
+	QCOMPARE(activated.count(), 4);
+	hotkey.setRepeatInterval(60000);
+	activated.clear();
+	holdKey(3);
+	QCOMPARE(activated.count(), 1);
+
+	// counted repeats report the repeats since the press, which starts over with every press
+	hotkey.setRepeatPolicy(QHotkey::CountRepeats);
+	hotkey.setRepeatInterval(0);
+	activated.clear();
+	holdKey(3);
+	QCOMPARE(activated.count(), 1);
+	QCOMPARE(repeated.count(), 3);
+	QCOMPARE(repeated.at(0).first().toInt(), 1);
+	QCOMPARE(repeated.at(2).first().toInt(), 3);
+	repeated.clear();
+	holdKey(1);
+	QCOMPARE(repeated.count(), 1);
+	QCOMPARE(repeated.first().first().toInt(), 1);
+
+	// repeats within the interval are counted, but not reported
+	hotkey.setRepeatInterval(60000);
+	repeated.clear();
+	holdKey(3);
+	QCOMPARE(repeated.count(), 0);
+}
+
+void VirtualBackendTest::modifierOnly()
+{
+	// the modifier the key sets itself is not part of the shortcut
+	QHotkey hotkey(Qt::Key_Control, Qt::NoModifier, true);
+	QHotkey same(Qt::Key_Control, Qt::ControlModifier);
+	QVERIFY(hotkey.isRegistered());
+	const QHotkey::NativeShortcut shortcut = hotkey.currentNativeShortcut();
+	QVERIFY(same.currentNativeShortcut() == shortcut);
+	QVERIFY(backend->isShortcutGrabbed(shortcut));
+
+	QSignalSpy activated(&hotkey, &QHotkey::activated);
+	QSignalSpy released(&hotkey, &QHotkey::released);
+	backend->injectPress(shortcut);
+	QTRY_COMPARE(activated.count(), 1);
+	QCOMPARE(released.count(), 0);
+	backend->injectRelease(shortcut);
+	QTRY_COMPARE(released.count(), 1);
+}
+
+void VirtualBackendTest::holdThreshold()
+{
+	QHotkey hotkey(Qt::Key_S, Qt::AltModifier, true);
+	hotkey.setHoldThreshold(50);
+	const QHotkey::NativeShortcut shortcut = hotkey.currentNativeShortcut();
+	QSignalSpy activated(&hotkey, &QHotkey::activated);
+	QSignalSpy released(&hotkey, &QHotkey::released);
+
+	// released before the threshold, nothing is emitted at all
+	backend->injectPress(shortcut);
+	backend->injectRelease(shortcut);
+	QTest::qWait(150);
+	QCOMPARE(activated.count(), 0);
+	QCOMPARE(released.count(), 0);
+
+	// held long enough, it activates while still held and releases as usual
+	backend->injectPress(shortcut);
+	QTRY_COMPARE(activated.count(), 1);
+	QCOMPARE(released.count(), 0);
+	backend->injectRelease(shortcut);
+	QTRY_COMPARE(released.count(), 1);
+	QCOMPARE(activated.count(), 1);
+}
+
+void VirtualBackendTest::probeAndQuery()
+{
+	QHotkey used(Qt::Key_T, Qt::AltModifier, true);
+	const QHotkey::NativeShortcut taken(Qt::Key_U, Qt::AltModifier);
+	const QHotkey::NativeShortcut available(Qt::Key_V, Qt::AltModifier);
+	backend->setShortcutRejected(taken, true);
+
+	const QList<QHotkey::Availability> result = QHotkey::probe({
+		QKeySequence(QStringLiteral("Alt+T")),
+		QKeySequence(QStringLiteral("Alt+U")),
+		QKeySequence(QStringLiteral("Alt+V")),
+		QKeySequence(Qt::Key_unknown)
+	});
+	QCOMPARE(result, (QList<QHotkey::Availability>{
+		QHotkey::InUse,
+		QHotkey::Taken,
+		QHotkey::Available,
+		QHotkey::Unsupported
+	}));
+	// probing never keeps a key grabbed
+	QVERIFY(!backend->isShortcutGrabbed(available));
+	QVERIFY(backend->isShortcutGrabbed(used.currentNativeShortcut()));
+	backend->setShortcutRejected(taken, false);
+
+	QCOMPARE(QHotkey::hotkeysFor(QKeySequence(QStringLiteral("Alt+T"))), QList<QHotkey*>{&used});
+	QCOMPARE(QHotkey::hotkeysForNative(used.currentNativeShortcut()), QList<QHotkey*>{&used});
+	QVERIFY(QHotkey::hotkeysFor(QKeySequence(QStringLiteral("Alt+V"))).isEmpty());
+	QVERIFY(used.setRegistered(false));
+	QVERIFY(QHotkey::hotkeysFor(QKeySequence(QStringLiteral("Alt+T"))).isEmpty());
+}
+
+void VirtualBackendTest::traceReplay()
+{
+	QHotkey hotkey(Qt::Key_W, Qt::AltModifier, true);
+	const QHotkey::NativeShortcut shortcut = hotkey.currentNativeShortcut();
+	QSignalSpy activated(&hotkey, &QHotkey::activated);
+	QSignalSpy released(&hotkey, &QHotkey::released);
+
+	QBuffer output;
+	QVERIFY(output.open(QIODevice::WriteOnly));
+	QHotkeyTrace recorder;
+	QVERIFY(recorder.startRecording(&output));
+	backend->injectPress(shortcut);
+	backend->injectRelease(shortcut);
+	backend->injectPress(shortcut);
+	backend->injectRelease(shortcut);
+	// keys without a hotkey are not recorded
+	backend->injectPress(QHotkey::NativeShortcut(Qt::Key_X, Qt::AltModifier));
+	recorder.stopRecording();
+	QCOMPARE(recorder.recordedEvents(), Q_UINT64_C(4));
+	QTRY_COMPARE(released.count(), 2);
+	activated.clear();
+	released.clear();
+
+	const QByteArray trace = output.data();
+	QHotkeyTrace player;
+	QSignalSpy finished(&player, &QHotkeyTrace::replayFinished);
+	const auto replay = [&player](QByteArray data) -> bool {
+		QBuffer input(&data);
+		input.open(QIODevice::ReadOnly);
+		return player.replay(&input, QHotkeyTrace::MaximumSpeed);
+	};
+
+	QVERIFY(replay(trace));
+	QCOMPARE(finished.count(), 1);
+	QCOMPARE(finished.last().first().value<quint64>(), Q_UINT64_C(4));
+	QTRY_COMPARE(activated.count(), 2);
+	QTRY_COMPARE(released.count(), 2);
+
+	// a trace cut off within its last event still replays the complete ones
+	QVERIFY(replay(trace.left(trace.size() - 1)));
+	QCOMPARE(finished.last().first().value<quint64>(), Q_UINT64_C(3));
+
+	// empty events are skipped, as they carry no message to filter
+	QByteArray emptyEvent = trace;
+	emptyEvent.append(10, '\0');
+	QVERIFY(replay(emptyEvent));
+	QCOMPARE(finished.last().first().value<quint64>(), Q_UINT64_C(4));
+
+	// empty or foreign data is no trace at all
+	QVERIFY(!replay(QByteArray()));
+	QVERIFY(!replay(QByteArrayLiteral("QHKTRACE")));
+	QCOMPARE(finished.count(), 3);
+}
+
+QTEST_MAIN(VirtualBackendTest)
+
+#include "tst_virtualbackend.moc"